@@ -13,7 +13,8 @@ ascii_view_focused = false
 function ascii_view_updateDimensions ()
     ascii_view = getSubView(ascii_view_id)
     ascii_view:setHeight(getHexViewHeight())
-    ascii_view:setWidth(math.floor((getViewWidth() - getLeftViewsWidth()) / 4))
+    -- One character per byte in the row
+    ascii_view:setWidth(getHexByteWidth())
     ascii_view:setX(0)
     ascii_view:setY(0)
 end
@@ -21,14 +22,10 @@ end
 ascii_view_updateDimensions()
 
 
-registerKeyHandler(function (key)
-    if getHexViewState() == HexViewState.Editing then
-        if key == string.byte('\t') then
-            logAtExit("Love! And Peace!")
-            ascii_view_focused = true
-        end
-    end
-end)
+registerKeyHandlerFor('\t', function (key)
+    logAtExit("Love! And Peace!")
+    ascii_view_focused = true
+end, nil, HexViewState.Editing)
 
 getSubView(ascii_view_id):onRender(function ()
     local ascii_view = getSubView(ascii_view_id)
@@ -0,0 +1,48 @@
+-- Configuration
+if block_edit_config == nil then
+    block_edit_config = {}
+end
+-- Bytes which filling repeats, and how many bytes from the cursor on are filled
+if block_edit_config["fill_pattern"] == nil then
+    block_edit_config["fill_pattern"] = {0}
+end
+if block_edit_config["fill_length"] == nil then
+    block_edit_config["fill_length"] = 4096
+end
+-- File that pasting copies from (nothing is pasted while it's nil), where in it, and how many bytes
+if block_edit_config["paste_offset"] == nil then
+    block_edit_config["paste_offset"] = 0
+end
+if block_edit_config["paste_length"] == nil then
+    block_edit_config["paste_length"] = 4096
+end
+if block_edit_config["fill_key"] == nil then
+    block_edit_config["fill_key"] = "f"
+end
+if block_edit_config["paste_key"] == nil then
+    block_edit_config["paste_key"] = "p"
+end
+
+-- fillRange(start, length, pattern) and pasteFromFile(path, source_offset, start, length) are each stored as a
+-- single edit which only keeps the pattern or where the bytes are in the other file, so they're quick at any size
+-- and one undo reverts them. Both stop at the end of the file.
+-- So the key doesn't do anything else. Only in the hex view itself, so typing it in another panel doesn't edit.
+local block_edit_handled = KeyHandled.Handler + KeyHandled.Special + KeyHandled.Drawing
+
+registerKeyHandlerFor(block_edit_config["fill_key"], function (key)
+    local selected = getSelectedPosition()
+    if fillRange(selected, block_edit_config["fill_length"], block_edit_config["fill_pattern"]) then
+        setBarMessage(string.format("Filled %d bytes from 0x%X.", math.min(block_edit_config["fill_length"], getFileEnd() - selected), selected))
+    end
+    return block_edit_handled
+end, UIState.Hex, HexViewState.Default)
+
+registerKeyHandlerFor(block_edit_config["paste_key"], function (key)
+    local selected = getSelectedPosition()
+    if block_edit_config["paste_file"] == nil then
+        setBarMessage("Set block_edit_config[\"paste_file\"] to paste from a file.")
+    elseif pasteFromFile(block_edit_config["paste_file"], block_edit_config["paste_offset"], selected, block_edit_config["paste_length"]) then
+        setBarMessage(string.format("Pasted from %s at 0x%X.", block_edit_config["paste_file"], selected))
+    end
+    return block_edit_handled
+end, UIState.Hex, HexViewState.Default)
@@ -0,0 +1,16 @@
+-- Configuration
+if data_inspector_config == nil then
+    data_inspector_config = {}
+end
+if data_inspector_config["width"] == nil then
+    data_inspector_config["width"] = 28
+end
+if data_inspector_config["visible"] == nil then
+    data_inspector_config["visible"] = true
+end
+
+-- The view is drawn natively, decoding the bytes at the cursor as integers (little and big endian), floats,
+-- a unix timestamp and LEB128 varints. Pressing 'i' shows/hides it.
+data_inspector_id = createDataInspectorView()
+getSubView(data_inspector_id):setWidth(data_inspector_config["width"])
+getSubView(data_inspector_id):setVisible(data_inspector_config["visible"])
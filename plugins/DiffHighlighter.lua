@@ -0,0 +1,20 @@
+-- Highlights the bytes which differ from the other file when running with --diff.
+-- Must be loaded after the other highlighters, since it wraps their highlight_get.
+
+if diff_highlighter_config == nil then
+    diff_highlighter_config = {}
+end
+if diff_highlighter_config["highlight"] == nil then
+    diff_highlighter_config["highlight"] = HighlightType.Color_RED_BLACK
+end
+
+if isDiffMode() then
+    local base_highlight_get = highlight_get
+
+    function highlight_get (position, effectless)
+        if isDiffPosition(position) then
+            return diff_highlighter_config["highlight"]
+        end
+        return base_highlight_get(position, effectless)
+    end
+end
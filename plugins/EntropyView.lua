@@ -0,0 +1,13 @@
+-- Configuration
+if entropy_view_config == nil then
+    entropy_view_config = {}
+end
+if entropy_view_config["width"] == nil then
+    entropy_view_config["width"] = 2
+end
+
+-- The view itself is drawn natively, since it covers the whole file.
+-- Rows are colored by entropy: blue (sparse), green (text/code), yellow, magenta, red (compressed/encrypted).
+-- Rows which are currently shown in the hex view are marked with '>'
+entropy_view_id = createEntropyView()
+getSubView(entropy_view_id):setWidth(entropy_view_config["width"])
@@ -0,0 +1,48 @@
+-- Configuration
+if hash_info_config == nil then
+    hash_info_config = {}
+end
+-- Any of "crc32", "crc32c", "sha1", "sha256", "xxh64"
+if hash_info_config["algorithms"] == nil then
+    hash_info_config["algorithms"] = {"crc32", "crc32c", "sha1", "sha256", "xxh64"}
+end
+-- How many bytes from the cursor onwards are hashed, besides the whole file
+if hash_info_config["selection_length"] == nil then
+    hash_info_config["selection_length"] = 256
+end
+
+-- The hashing is done natively with hashRange(algorithm, start, length), which uses the CPU's crc32/pclmul/sha
+-- instructions when it has them. Edits which are not yet saved are included.
+function hash_info_format (digests)
+    local text = ""
+    for _, algorithm in ipairs(hash_info_config["algorithms"]) do
+        text = text .. string.format("%-7s %s (%s)\n", algorithm, digests[algorithm], getHashImplementation(algorithm))
+    end
+    return text
+end
+
+function hash_info_describe (start, length)
+    local digests = {}
+    for _, algorithm in ipairs(hash_info_config["algorithms"]) do
+        digests[algorithm] = hashRange(algorithm, start, length)
+    end
+    return hash_info_format(digests)
+end
+
+registerInfo("Hashes", function ()
+    local file_end = getFileEnd()
+    local selected = getSelectedPosition()
+    local length = math.min(hash_info_config["selection_length"], file_end - selected)
+
+    -- The whole file is hashed in the background, with every algorithm in one pass, and kept until it's edited.
+    -- This is called again once it's done.
+    local text = string.format("File (%d bytes)\n", file_end)
+    local file_digests = fileHashes(hash_info_config["algorithms"])
+    if file_digests == nil then
+        text = text .. "Hashing...\n"
+    else
+        text = text .. hash_info_format(file_digests)
+    end
+
+    return text .. "\n" .. string.format("From 0x%X (%d bytes)\n", selected, length) .. hash_info_describe(selected, length)
+end)
@@ -23,10 +23,10 @@ end
 local prev_state = getHexViewState()
 local requires_rehighlight = false
 
-listenForUndo(function (pos)
+listenForUndo(function (pos, length)
     requires_rehighlight = true
 end)
-listenForRedo(function (pos)
+listenForRedo(function (pos, length)
     requires_rehighlight = true
 end)
 
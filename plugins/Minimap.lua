@@ -0,0 +1,11 @@
+-- Configuration
+if minimap_view_config == nil then
+    minimap_view_config = {}
+end
+if minimap_view_config["width"] == nil then
+    minimap_view_config["width"] = 3
+end
+
+-- Drawn natively from the file summary, see the README for what each row means.
+minimap_view_id = createMinimapView()
+getSubView(minimap_view_id):setWidth(minimap_view_config["width"])
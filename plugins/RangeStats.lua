@@ -0,0 +1,79 @@
+-- Configuration
+if range_stats_config == nil then
+    range_stats_config = {}
+end
+-- How many bytes from the cursor onwards are looked at, besides the whole file
+if range_stats_config["selection_length"] == nil then
+    range_stats_config["selection_length"] = 4096
+end
+-- How many of the most common byte values to list
+if range_stats_config["top_values"] == nil then
+    range_stats_config["top_values"] = 8
+end
+
+-- A rough guess at what the data is, from its statistics
+function range_stats_classify (stats)
+    if stats.total == 0 then
+        return "empty"
+    end
+
+    local zero_ratio = stats.zeroes / stats.total
+    if zero_ratio > 0.9 then
+        return "padding (mostly zeroes)"
+    elseif stats.printable_ratio > 0.85 then
+        return "text"
+    elseif stats.entropy > 7.5 then
+        return "compressed or encrypted"
+    elseif stats.entropy < 5 and zero_ratio > 0.2 then
+        return "structured binary (tables, headers)"
+    end
+    return "binary (code or data)"
+end
+
+-- rangeStats(start, length) does the counting natively, and returns a table with:
+-- total, zeroes, zero_runs, longest_zero_run, printable, printable_ratio, entropy, min, max (nil when empty)
+-- and histogram, which is indexed by byte value (0 to 255).
+function range_stats_describe (stats)
+    local text = string.format("Guess: %s\n", range_stats_classify(stats))
+    text = text .. string.format("Entropy: %.3f bits/byte\n", stats.entropy)
+    if stats.total ~= 0 then
+        text = text .. string.format("Printable: %.1f%%\n", stats.printable_ratio * 100)
+        text = text .. string.format("Min: 0x%02X Max: 0x%02X\n", stats.min, stats.max)
+    end
+    text = text .. string.format("Zeroes: %d in %d runs, longest %d\n", stats.zeroes, stats.zero_runs, stats.longest_zero_run)
+
+    local values = {}
+    for value = 0, 255 do
+        if stats.histogram[value] ~= 0 then
+            table.insert(values, value)
+        end
+    end
+    table.sort(values, function (a, b)
+        return stats.histogram[a] > stats.histogram[b]
+    end)
+
+    text = text .. "Most common:"
+    for i = 1, math.min(range_stats_config["top_values"], #values) do
+        local value = values[i]
+        text = text .. string.format(" %02X (%.1f%%)", value, stats.histogram[value] * 100 / stats.total)
+    end
+    return text .. "\n"
+end
+
+registerInfo("Statistics", function ()
+    local file_end = getFileEnd()
+    local selected = getSelectedPosition()
+    local length = math.min(range_stats_config["selection_length"], file_end - selected)
+
+    -- The whole file is counted in the background and kept until it's edited, this is called again once it's done
+    local text = string.format("File (%d bytes)\n", file_end)
+    local file_stats = fileStats()
+    if file_stats == nil then
+        text = text .. "Counting...\n"
+    else
+        text = text .. range_stats_describe(file_stats)
+    end
+
+    return text .. "\n" .. string.format("From 0x%X (%d bytes)\n", selected, length) ..
+        range_stats_describe(rangeStats(selected, length))
+end)
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+
+# Compares the speed of the built-in hashing against the coreutils tools, and the accelerated versions against the
+# portable ones. Expects the program to already be built.
+# Usage: ./scripts/bench_hash.sh [file]
+# Without a file, a 512MiB file of random data is made in /tmp and removed afterwards.
+
+set -e
+
+program=./build/program
+file=$1
+
+if [ -z "$file" ]; then
+    file=$(mktemp /tmp/herixtui_bench.XXXXXX)
+    trap 'rm -f "$file"' EXIT
+    head -c $((512 * 1024 * 1024)) /dev/urandom > "$file"
+fi
+
+# Warm the page cache so that the first run isn't penalized
+cat "$file" > /dev/null
+
+time_of () {
+    local start end
+    start=$(date +%s.%N)
+    "$@" > /dev/null 2>&1
+    end=$(date +%s.%N)
+    echo "$end - $start" | bc
+}
+
+echo "sha256sum:               $(time_of sha256sum "$file")s"
+echo "sha1sum:                 $(time_of sha1sum "$file")s"
+for algorithm in crc32 crc32c sha1 sha256 xxh64; do
+    printf "%-8s accelerated:    %ss\n" "$algorithm" "$(time_of $program --hash $algorithm "$file")"
+    printf "%-8s portable:       %ss\n" "$algorithm" "$(time_of $program --hash $algorithm --hash_portable "$file")"
+done
+
+# Make sure the digests actually agree
+ours=$($program --hash sha256 "$file" 2> /dev/null | cut -d' ' -f1)
+theirs=$(sha256sum "$file" | cut -d' ' -f1)
+if [ "$ours" != "$theirs" ]; then
+    echo "sha256 mismatch: $ours != $theirs"
+    exit 1
+fi
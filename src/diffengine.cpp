@@ -0,0 +1,358 @@
+#include "./diffengine.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+
+namespace {
+    // Reads forward through a file, keeping only what's asked for in memory.
+    class FileWindow {
+        public:
+        FileWindow (const std::filesystem::path& filename, HerixLib::AbsoluteFilePosition t_base, size_t t_size, size_t t_read_size) :
+            file(filename, std::ios::binary), base(t_base), size(t_size), read_size(t_read_size) {}
+
+        // Makes [pos, pos + length) available, cut off at the end of the file, and returns a pointer to pos.
+        // available is set to how much of it there is. Anything before pos may be dropped, so earlier pointers
+        // into this window are invalidated.
+        const HerixLib::Byte* get (HerixLib::FilePosition pos, size_t length, size_t& available) {
+            length = pos < size ? std::min(length, size - pos) : 0;
+            if (pos < buffer_start || pos + length > buffer_start + buffer.size()) {
+                refill(pos, length);
+            }
+
+            size_t offset = pos - buffer_start;
+            available = std::min(length, buffer.size() > offset ? buffer.size() - offset : 0);
+            return buffer.data() + std::min(offset, buffer.size());
+        }
+
+        private:
+        std::ifstream file;
+        HerixLib::AbsoluteFilePosition base;
+        size_t size;
+        size_t read_size;
+        std::vector<HerixLib::Byte> buffer;
+        HerixLib::FilePosition buffer_start = 0;
+
+        void refill (HerixLib::FilePosition pos, size_t length) {
+            if (pos >= buffer_start && pos <= buffer_start + buffer.size()) {
+                // Keep what overlaps, so moving forward doesn't reread it
+                buffer.erase(buffer.begin(), buffer.begin() + static_cast<long>(pos - buffer_start));
+            } else {
+                buffer.clear();
+            }
+            buffer_start = pos;
+
+            size_t want = std::min(std::max(length, read_size), size - pos);
+            if (buffer.size() >= want || !file) {
+                return;
+            }
+
+            size_t have = buffer.size();
+            buffer.resize(want);
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(base + buffer_start + have));
+            file.read(reinterpret_cast<char*>(buffer.data() + have), static_cast<std::streamsize>(want - have));
+            buffer.resize(have + static_cast<size_t>(std::max<std::streamsize>(file.gcount(), 0)));
+        }
+    };
+
+    // Random values for each byte, for buzhash.
+    const std::array<uint32_t, 256>& getBuzhashTable () {
+        static const std::array<uint32_t, 256> table = [] () {
+            std::array<uint32_t, 256> ret;
+            // splitmix64, so the table is the same every run
+            uint64_t state = 0x9E3779B97F4A7C15ULL;
+            for (uint32_t& value : ret) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                value = static_cast<uint32_t>(z ^ (z >> 31));
+            }
+            return ret;
+        }();
+        return table;
+    }
+
+    uint32_t rotl32 (uint32_t v, size_t amount) {
+        amount %= 32;
+        return amount == 0 ? v : (v << amount) | (v >> (32 - amount));
+    }
+
+    // Hash of every block_size window of data, rolled along one byte at a time. func(position, hash)
+    template<typename F>
+    void rollBuzhash (const HerixLib::Byte* data, size_t size, size_t block_size, F func) {
+        if (size < block_size) {
+            return;
+        }
+        const std::array<uint32_t, 256>& table = getBuzhashTable();
+
+        uint32_t hash = 0;
+        for (size_t i = 0; i < block_size; i++) {
+            hash = rotl32(hash, 1) ^ table[data[i]];
+        }
+        for (size_t i = 0; ; i++) {
+            if (!func(i, hash)) {
+                return;
+            }
+            if (i + block_size >= size) {
+                return;
+            }
+            hash = rotl32(hash, 1) ^ rotl32(table[data[i]], block_size) ^ table[data[i + block_size]];
+        }
+    }
+
+    struct Alignment {
+        size_t a;
+        size_t b;
+    };
+
+    // Where the two windows line up again with the least skipped in total, if they do.
+    // Every block in b is put in a table (keeping the first position for each hash), then a is rolled through
+    // looking for blocks that are in it.
+    std::optional<Alignment> findAlignment (const HerixLib::Byte* a, size_t a_size, const HerixLib::Byte* b, size_t b_size, size_t block_size) {
+        if (a_size < block_size || b_size < block_size) {
+            return std::nullopt;
+        }
+
+        // Open addressing, with positions stored off by one so that zero is empty
+        size_t capacity = 16;
+        while (capacity < (b_size - block_size + 1) * 2) {
+            capacity *= 2;
+        }
+        std::vector<std::pair<uint32_t, size_t>> table(capacity, std::make_pair(0u, 0));
+        const size_t mask = capacity - 1;
+
+        rollBuzhash(b, b_size, block_size, [&] (size_t pos, uint32_t hash) {
+            for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+                if (table[slot].second == 0) {
+                    table[slot] = std::make_pair(hash, pos + 1);
+                    break;
+                } else if (table[slot].first == hash) {
+                    break;
+                }
+            }
+            return true;
+        });
+
+        std::optional<Alignment> best = std::nullopt;
+        rollBuzhash(a, a_size, block_size, [&] (size_t pos, uint32_t hash) {
+            // Nothing further along can be better
+            if (best.has_value() && pos >= best->a + best->b) {
+                return false;
+            }
+
+            for (size_t slot = hash & mask; table[slot].second != 0; slot = (slot + 1) & mask) {
+                if (table[slot].first != hash) {
+                    continue;
+                }
+                size_t b_pos = table[slot].second - 1;
+                if ((!best.has_value() || pos + b_pos < best->a + best->b) &&
+                    std::memcmp(a + pos, b + b_pos, block_size) == 0) {
+                    best = Alignment{pos, b_pos};
+                }
+                break;
+            }
+            return true;
+        });
+        return best;
+    }
+}
+
+DiffEngine::DiffEngine (std::filesystem::path t_filename_a, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range_a,
+    std::filesystem::path t_filename_b, DiffOptions t_options, std::function<void()> t_on_finished) :
+    filename_a(t_filename_a), file_range_a(t_file_range_a), filename_b(t_filename_b), options(t_options), on_finished(std::move(t_on_finished)) {
+    options.block_size = std::max<size_t>(options.block_size, 1);
+    options.max_window = std::max(options.max_window, options.block_size * 2);
+
+    std::error_code error;
+    size_t file_size_a = static_cast<size_t>(std::filesystem::file_size(filename_a, error));
+    if (error) {
+        file_size_a = 0;
+    }
+    size_t end_a = std::min(file_size_a, static_cast<size_t>(file_range_a.second.value_or(file_size_a)));
+    size_a = end_a > file_range_a.first ? end_a - file_range_a.first : 0;
+
+    size_b = static_cast<size_t>(std::filesystem::file_size(filename_b, error));
+    if (error) {
+        size_b = 0;
+    }
+
+    worker = std::thread(&DiffEngine::runWorker, this);
+}
+
+DiffEngine::~DiffEngine () {
+    worker_stop = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool DiffEngine::update () {
+    if (done) {
+        return false;
+    }
+
+    // Checked before taking the hunks, so that the last ones aren't missed
+    bool finished = worker_done.load(std::memory_order_acquire);
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        changed = !worker_hunks.empty();
+        hunks.insert(hunks.end(), worker_hunks.begin(), worker_hunks.end());
+        worker_hunks.clear();
+    }
+    done = finished;
+    return changed || finished;
+}
+
+bool DiffEngine::isDone () const {
+    return done;
+}
+
+HerixLib::FilePosition DiffEngine::getProgress () const {
+    return worker_progress.load(std::memory_order_relaxed);
+}
+
+size_t DiffEngine::getSizeA () const {
+    return size_a;
+}
+size_t DiffEngine::getSizeB () const {
+    return size_b;
+}
+
+const std::vector<DiffHunk>& DiffEngine::getHunks () const {
+    return hunks;
+}
+
+size_t DiffEngine::findHunkA (HerixLib::FilePosition pos) const {
+    auto it = std::upper_bound(hunks.begin(), hunks.end(), pos, [] (HerixLib::FilePosition p, const DiffHunk& hunk) {
+        return p < hunk.a_start + hunk.a_length;
+    });
+    return static_cast<size_t>(it - hunks.begin());
+}
+
+bool DiffEngine::isDifferentA (HerixLib::FilePosition pos) const {
+    size_t index = findHunkA(pos);
+    return index < hunks.size() && hunks[index].a_start <= pos;
+}
+
+bool DiffEngine::isDifferentB (HerixLib::FilePosition pos) const {
+    auto it = std::upper_bound(hunks.begin(), hunks.end(), pos, [] (HerixLib::FilePosition p, const DiffHunk& hunk) {
+        return p < hunk.b_start + hunk.b_length;
+    });
+    return it != hunks.end() && it->b_start <= pos;
+}
+
+HerixLib::FilePosition DiffEngine::mapToB (HerixLib::FilePosition pos) const {
+    // Last hunk starting at or before pos
+    auto it = std::upper_bound(hunks.begin(), hunks.end(), pos, [] (HerixLib::FilePosition p, const DiffHunk& hunk) {
+        return p < hunk.a_start;
+    });
+    if (it == hunks.begin()) {
+        return pos;
+    }
+    --it;
+
+    HerixLib::FilePosition offset = pos - it->a_start;
+    if (offset < it->a_length) {
+        return it->b_start + std::min(offset, it->b_length);
+    }
+    return it->b_start + it->b_length + (offset - it->a_length);
+}
+
+void DiffEngine::publish (const DiffHunk& hunk) {
+    std::lock_guard<std::mutex> lock(worker_mutex);
+    worker_hunks.push_back(hunk);
+}
+
+void DiffEngine::runWorker () {
+    FileWindow window_a(filename_a, file_range_a.first, size_a, options.read_size);
+    FileWindow window_b(filename_b, 0, size_b, options.read_size);
+    const size_t block_size = options.block_size;
+
+    // The last hunk is held back until the next one, since giving up on a window can leave several in a row that
+    // should be one.
+    std::optional<DiffHunk> pending = std::nullopt;
+    auto addHunk = [this] (std::optional<DiffHunk>& last, const DiffHunk& hunk) {
+        if (last.has_value() && last->a_start + last->a_length == hunk.a_start && last->b_start + last->b_length == hunk.b_start) {
+            last->a_length += hunk.a_length;
+            last->b_length += hunk.b_length;
+            return;
+        }
+        if (last.has_value()) {
+            publish(last.value());
+        }
+        last = hunk;
+    };
+
+    HerixLib::FilePosition a = 0;
+    HerixLib::FilePosition b = 0;
+    while (!worker_stop && a < size_a && b < size_b) {
+        size_t a_available;
+        size_t b_available;
+        const HerixLib::Byte* a_data = window_a.get(a, options.read_size, a_available);
+        const HerixLib::Byte* b_data = window_b.get(b, options.read_size, b_available);
+        size_t length = std::min(a_available, b_available);
+        if (length == 0) {
+            break;
+        }
+
+        size_t same = static_cast<size_t>(std::mismatch(a_data, a_data + length, b_data).first - a_data);
+        a += same;
+        b += same;
+        worker_progress.store(a, std::memory_order_relaxed);
+        if (same == length) {
+            continue;
+        }
+
+        std::optional<Alignment> alignment = std::nullopt;
+        size_t window = std::min<size_t>(256, options.max_window);
+
+        // Changed in place is the most common, and cheap to check for
+        a_data = window_a.get(a, window + block_size, a_available);
+        b_data = window_b.get(b, window + block_size, b_available);
+        size_t in_place = std::min(a_available, b_available);
+        for (size_t d = 1; d < window && d + block_size <= in_place; d++) {
+            if (a_data[d] == b_data[d] && std::memcmp(a_data + d, b_data + d, block_size) == 0) {
+                alignment = Alignment{d, d};
+                break;
+            }
+        }
+
+        // Otherwise find where they line up again, looking further ahead each time it fails
+        while (!alignment.has_value() && !worker_stop) {
+            a_data = window_a.get(a, window + block_size, a_available);
+            b_data = window_b.get(b, window + block_size, b_available);
+            alignment = findAlignment(a_data, a_available, b_data, b_available, block_size);
+
+            bool searched_everything = a_available < window + block_size && b_available < window + block_size;
+            if (window >= options.max_window || searched_everything) {
+                break;
+            }
+            window = std::min(window * 4, options.max_window);
+        }
+
+        // Didn't line up, so count the whole window as changed
+        Alignment skip = alignment.value_or(Alignment{std::min(window, a_available), std::min(window, b_available)});
+        addHunk(pending, DiffHunk{a, skip.a, b, skip.b});
+        a += skip.a;
+        b += skip.b;
+        worker_progress.store(a, std::memory_order_relaxed);
+    }
+
+    // Whatever is left of the longer file
+    if (!worker_stop && (a < size_a || b < size_b)) {
+        addHunk(pending, DiffHunk{a, size_a - std::min(a, size_a), b, size_b - std::min(b, size_b)});
+    }
+    if (pending.has_value()) {
+        publish(pending.value());
+    }
+    worker_progress.store(size_a, std::memory_order_relaxed);
+    worker_done.store(true, std::memory_order_release);
+    if (on_finished) {
+        on_finished();
+    }
+}
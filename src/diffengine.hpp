@@ -0,0 +1,90 @@
+#ifndef FILE_SEEN_DIFFENGINE
+#define FILE_SEEN_DIFFENGINE
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include "./Herix/src/herix.hpp"
+
+// A differing stretch between the two files. One of the lengths is zero for pure insertions/deletions.
+struct DiffHunk {
+    HerixLib::FilePosition a_start;
+    size_t a_length;
+    HerixLib::FilePosition b_start;
+    size_t b_length;
+};
+
+struct DiffOptions {
+    // How many bytes have to match for the files to be considered back in sync after a difference.
+    size_t block_size = 32;
+    // How far ahead (in each file) to look for them to line up again. Past that the whole window is counted as
+    // changed, and comparing continues after it.
+    size_t max_window = 1024 * 1024;
+    // How much is read from each file at a time
+    size_t read_size = 1024 * 1024;
+};
+
+// Compares two files on disk in a worker thread, streaming through both, so memory use is bounded by the options
+// rather than the sizes of the files.
+// Equal stretches are compared directly. On a mismatch it tries to find where the files line up again, first at
+// the same offset (bytes changed in place) and then through a rolling hash (buzhash) over growing windows, which
+// finds bytes that were inserted or deleted.
+// Hunks are handed over to the main thread in update(), like FileSummary does.
+class DiffEngine {
+    public:
+    // on_finished is called from the worker thread once it is done, so it has to be thread safe.
+    DiffEngine (std::filesystem::path t_filename_a, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range_a,
+        std::filesystem::path t_filename_b, DiffOptions t_options, std::function<void()> t_on_finished = nullptr);
+    DiffEngine (const DiffEngine&) = delete;
+    DiffEngine& operator= (const DiffEngine&) = delete;
+    ~DiffEngine ();
+
+    // Takes in the hunks the worker has found since the last call. Returns true if there were any.
+    bool update ();
+    // If the worker has finished and everything it found has been taken in.
+    bool isDone () const;
+    // How far into file a the worker has gotten
+    HerixLib::FilePosition getProgress () const;
+    size_t getSizeA () const;
+    size_t getSizeB () const;
+
+    // Sorted by position, in both files.
+    const std::vector<DiffHunk>& getHunks () const;
+    // Index of the first hunk which ends after pos in file a, or the amount of hunks if there is none.
+    size_t findHunkA (HerixLib::FilePosition pos) const;
+    // If the byte is in a hunk, of the respective file.
+    bool isDifferentA (HerixLib::FilePosition pos) const;
+    bool isDifferentB (HerixLib::FilePosition pos) const;
+    // The position in file b which lines up with pos in file a, so both views can be kept in sync.
+    HerixLib::FilePosition mapToB (HerixLib::FilePosition pos) const;
+
+    private:
+    std::filesystem::path filename_a;
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range_a;
+    std::filesystem::path filename_b;
+    DiffOptions options;
+    size_t size_a = 0;
+    size_t size_b = 0;
+
+    std::vector<DiffHunk> hunks;
+
+    // Shared with the worker
+    std::mutex worker_mutex;
+    std::vector<DiffHunk> worker_hunks;
+    std::atomic<HerixLib::FilePosition> worker_progress = 0;
+    std::atomic<bool> worker_done = false;
+    std::atomic<bool> worker_stop = false;
+    std::function<void()> on_finished;
+    bool done = false;
+    std::thread worker;
+
+    void runWorker ();
+    void publish (const DiffHunk& hunk);
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "./diffview.hpp"
+
+void renderDiffView (SubView& sub_view, ViewWindow& view, HerixLib::Herix& hex_b, const DiffEngine& diff, HerixLib::FilePosition b_start, size_t bytes_per_row) {
+    const size_t height = static_cast<size_t>(std::max(sub_view.getHeight(), 0));
+    if (height == 0 || bytes_per_row == 0) {
+        return;
+    }
+
+    std::vector<HerixLib::Byte> data = hex_b.readMultipleCutoff(b_start, bytes_per_row * height);
+    for (size_t row = 0; row < height; row++) {
+        sub_view.move(0, static_cast<int>(row));
+        for (size_t column = 0; column < bytes_per_row; column++) {
+            size_t index = row * bytes_per_row + column;
+            if (index >= data.size()) {
+                return;
+            }
+
+            bool different = diff.isDifferentB(b_start + index);
+            if (different) {
+                view.enableColor(MColors::RED_BLACK);
+            }
+            sub_view.print(byteToStringPadded(data[index]));
+            if (different) {
+                view.disableColor(MColors::RED_BLACK);
+            }
+            sub_view.print(" ");
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef FILE_SEEN_DIFFVIEW
+#define FILE_SEEN_DIFFVIEW
+
+#include "./subview.hpp"
+#include "./window.hpp"
+#include "./diffengine.hpp"
+
+// Draws the second file of a diff as hex, laid out like the main hex view, starting at b_start.
+// Bytes which are in a hunk are colored.
+void renderDiffView (SubView& sub_view, ViewWindow& view, HerixLib::Herix& hex_b, const DiffEngine& diff, HerixLib::FilePosition b_start, size_t bytes_per_row);
+
+#endif
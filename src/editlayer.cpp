@@ -0,0 +1,1267 @@
+#include "./editlayer.hpp"
+
+#include <chrono>
+#include <cerrno>
+#include <limits>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "./hashing.hpp"
+
+namespace {
+    // Records with less data than this are never spilled
+    constexpr size_t MIN_SPILL_SIZE = 256;
+    // How much of each of the start, middle and end of the file goes into its fingerprint
+    constexpr size_t FINGERPRINT_SAMPLE_SIZE = 64 * 1024;
+
+    // Records in the undo journal are in the machine's byte order, like the save journal
+    void appendValue (std::vector<HerixLib::Byte>& out, uint64_t value) {
+        const auto* bytes = reinterpret_cast<const HerixLib::Byte*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+    void appendPieces (std::vector<HerixLib::Byte>& out, const std::vector<Piece>& pieces) {
+        appendValue(out, pieces.size());
+        for (const Piece& piece : pieces) {
+            out.push_back(static_cast<HerixLib::Byte>(piece.source));
+            appendValue(out, piece.offset);
+            appendValue(out, piece.length);
+        }
+    }
+
+    // Fills out with the pattern repeated, starting phase bytes into it
+    void repeatPattern (const HerixLib::Byte* pattern, size_t pattern_size, size_t phase, HerixLib::Byte* out, size_t size) {
+        phase %= pattern_size;
+        size_t filled = 0;
+        for (; filled < std::min(size, pattern_size); filled++) {
+            out[filled] = pattern[(phase + filled) % pattern_size];
+        }
+        // Doubling what's written so far, which stays lined up since it's a whole number of patterns
+        while (filled < size) {
+            size_t amount = std::min(filled, size - filled);
+            std::memcpy(out + filled, out, amount);
+            filled += amount;
+        }
+    }
+
+    // Reads back what the append functions wrote, throwing std::runtime_error if it runs past the end.
+    struct EntryReader {
+        const HerixLib::Byte* data;
+        size_t size;
+        size_t pos = 0;
+
+        const HerixLib::Byte* take (size_t length) {
+            if (length > size - pos) {
+                throw std::runtime_error("Undo history entry is damaged.");
+            }
+            pos += length;
+            return data + pos - length;
+        }
+        uint64_t readValue () {
+            uint64_t value = 0;
+            std::memcpy(&value, take(sizeof(value)), sizeof(value));
+            return value;
+        }
+        std::vector<Piece> readPieces () {
+            std::vector<Piece> pieces(static_cast<size_t>(readValue()));
+            for (Piece& piece : pieces) {
+                piece.source = *take(1) == 0 ? PieceSource::Original : PieceSource::Added;
+                piece.offset = readValue();
+                piece.length = static_cast<size_t>(readValue());
+            }
+            return pieces;
+        }
+    };
+
+    // Upper bound on a single write, so that a huge extent doesn't need to be in memory at once
+    constexpr size_t SAVE_WRITE_SIZE = 8 * 1024 * 1024;
+    // Largest record a paste out of the edited file itself is copied into, so the memory budget can spill it as it goes
+    constexpr size_t SELF_PASTE_RECORD_SIZE = 4 * 1024 * 1024;
+
+    void writeAll (int fd, const HerixLib::Byte* data, size_t size, off_t offset) {
+        while (size > 0) {
+            ssize_t written = pwrite(fd, data, size, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("Failed writing to file: ") + std::strerror(errno));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset += written;
+        }
+    }
+
+    void syncFile (int fd, const std::string& what) {
+        if (fdatasync(fd) != 0) {
+            throw std::runtime_error("Failed syncing " + what + ": " + std::strerror(errno));
+        }
+    }
+
+    // So that creating/removing the journal is itself durable
+    void syncDirectory (const std::filesystem::path& path) {
+        std::filesystem::path directory = path.parent_path();
+        if (directory.empty()) {
+            directory = ".";
+        }
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    // Journal layout: JOURNAL_MAGIC, then entries of [u64 offset][u64 length][length bytes], where the offset is
+    // absolute in the file, then an entry with JOURNAL_END as its offset and 0 as its length, then the xxh64 (as
+    // hex) of everything before it. Integers are in the machine's byte order, since it's only read back by the
+    // same machine.
+    constexpr char JOURNAL_MAGIC[8] = {'H', 'E', 'R', 'I', 'X', 'J', 'N', 'L'};
+    constexpr uint64_t JOURNAL_END = std::numeric_limits<uint64_t>::max();
+    constexpr size_t JOURNAL_DIGEST_SIZE = 16;
+
+    // Goes through the entries of a journal, calling func(offset, data, length) for each.
+    // Returns false if the journal is incomplete or damaged. Entries are only handed out once verify is false,
+    // so it should first be checked with verify set.
+    template<typename F>
+    bool readJournal (const std::filesystem::path& journal_path, bool verify, F func) {
+        std::ifstream file(journal_path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::error_code error;
+        const uint64_t journal_size = std::filesystem::file_size(journal_path, error);
+        if (error) {
+            return false;
+        }
+
+        Hasher hasher(HashAlgorithm::XXH64);
+        uint64_t consumed = 0;
+        auto readExact = [&] (void* out, size_t size) -> bool {
+            file.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(size));
+            if (static_cast<size_t>(file.gcount()) != size) {
+                return false;
+            }
+            hasher.update(reinterpret_cast<const HerixLib::Byte*>(out), size);
+            consumed += size;
+            return true;
+        };
+
+        char magic[sizeof(JOURNAL_MAGIC)];
+        if (!readExact(magic, sizeof(magic)) || std::memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) != 0) {
+            return false;
+        }
+
+        std::vector<HerixLib::Byte> data;
+        while (true) {
+            uint64_t offset = 0;
+            uint64_t length = 0;
+            if (!readExact(&offset, sizeof(offset)) || !readExact(&length, sizeof(length))) {
+                return false;
+            }
+            if (offset == JOURNAL_END) {
+                break;
+            }
+            // The length isn't covered by the digest until the end, so a damaged one can't be allocated for
+            if (length > journal_size - consumed) {
+                return false;
+            }
+
+            data.resize(length);
+            if (!readExact(data.data(), data.size())) {
+                return false;
+            }
+            if (!verify) {
+                func(offset, data.data(), data.size());
+            }
+        }
+
+        std::string expected = hasher.finish();
+        std::string digest(JOURNAL_DIGEST_SIZE, '\0');
+        file.read(digest.data(), static_cast<std::streamsize>(digest.size()));
+        return static_cast<size_t>(file.gcount()) == digest.size() && digest == expected;
+    }
+}
+
+PasteFile::PasteFile (const std::filesystem::path& t_path) : path(std::filesystem::absolute(t_path)) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open '" + path.string() + "': " + std::strerror(errno));
+    }
+}
+PasteFile::~PasteFile () {
+    close(fd);
+}
+
+const std::filesystem::path& PasteFile::getPath () const {
+    return path;
+}
+uint64_t PasteFile::getSize () const {
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(file_stat.st_size);
+}
+void PasteFile::read (uint64_t offset, HerixLib::Byte* out, size_t size) const {
+    while (size > 0) {
+        ssize_t amount = pread(fd, out, size, static_cast<off_t>(offset));
+        if (amount < 0 && errno == EINTR) {
+            continue;
+        } else if (amount <= 0) {
+            std::fill(out, out + size, 0);
+            return;
+        }
+        out += amount;
+        size -= static_cast<size_t>(amount);
+        offset += static_cast<uint64_t>(amount);
+    }
+}
+
+size_t EditRecord::getDataSize () const {
+    return spill_offset.has_value() ? spilled_size : data.size();
+}
+size_t EditRecord::getRunOffset (size_t index) const {
+    if (getDataSize() == length) {
+        return 0;
+    }
+    return index * length;
+}
+size_t EditRecord::getRemovedLength () const {
+    size_t total = 0;
+    for (const Piece& piece : removed) {
+        total += piece.length;
+    }
+    return total;
+}
+size_t EditRecord::getInsertedLength () const {
+    size_t total = 0;
+    for (const Piece& piece : inserted) {
+        total += piece.length;
+    }
+    return total;
+}
+
+EditLayer::EditLayer () {}
+EditLayer::EditLayer (std::filesystem::path t_filename, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range,
+    HerixLib::ChunkSize t_max_chunk_memory, HerixLib::ChunkSize t_max_chunk_size) :
+    allow_writing(t_allow_writing), filename(t_filename), file_range(t_file_range),
+    max_chunk_memory(t_max_chunk_memory), max_chunk_size(t_max_chunk_size) {
+    reopen();
+}
+
+std::optional<HerixLib::Byte> EditLayer::read (HerixLib::FilePosition pos) {
+    std::vector<HerixLib::Byte> data = readMultipleCutoff(pos, 1);
+    if (data.empty()) {
+        return std::nullopt;
+    }
+    return data[0];
+}
+std::vector<HerixLib::Byte> EditLayer::readMultipleCutoff (HerixLib::FilePosition pos, size_t length) {
+    if (layout_records == 0) {
+        // Nothing moved, so it's the original file with the overwrites on top
+        std::vector<HerixLib::Byte> data = base.readMultipleCutoff(pos, length);
+        applyRecords(pos, data.data(), data.size());
+        return data;
+    }
+
+    const size_t file_end = table.getLength();
+    if (pos >= file_end) {
+        return {};
+    }
+    length = std::min(length, file_end - pos);
+
+    std::vector<HerixLib::Byte> data(length, 0);
+    table.forEachPiece(pos, length, [&] (const Piece& piece, HerixLib::FilePosition piece_pos) {
+        HerixLib::Byte* out = data.data() + (piece_pos - pos);
+        if (piece.source == PieceSource::Original) {
+            std::vector<HerixLib::Byte> original = base.readMultipleCutoff(piece.offset, piece.length);
+            std::copy(original.begin(), original.end(), out);
+            applyRecords(piece.offset, out, piece.length);
+        } else {
+            readAdded(piece.offset, out, piece.length);
+            applyRecords(ADDED_SOURCE + piece.offset, out, piece.length);
+        }
+    });
+    return data;
+}
+size_t EditLayer::getFileEnd () {
+    return table.getLength();
+}
+
+void EditLayer::prefetch (HerixLib::FilePosition pos, size_t length) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    // Inserted bytes are already in memory (or the spill file), only the parts from the file need reading
+    table.forEachPiece(pos, length, [&] (const Piece& piece, HerixLib::FilePosition) {
+        if (piece.source == PieceSource::Original) {
+            posix_fadvise(fd, static_cast<off_t>(file_range.first + piece.offset), static_cast<off_t>(piece.length), POSIX_FADV_WILLNEED);
+        }
+    });
+    ::close(fd);
+}
+
+void EditLayer::edit (HerixLib::FilePosition pos, HerixLib::Byte value) {
+    if (pos >= getFileEnd()) {
+        return;
+    }
+
+    EditRecord* session = getSessionRecord();
+    if (session != nullptr && session->kind == EditKind::Layout && session->inserted.size() == 1 &&
+        pos >= session->layout_pos && pos < session->layout_pos + session->inserted[0].length) {
+        // Nothing else refers to bytes inserted in this session yet
+        added[session->inserted[0].offset + (pos - session->layout_pos) - added_spilled] = value;
+        version++;
+        return;
+    }
+
+    const HerixLib::FilePosition source_pos = toSource(pos).first;
+    if (session != nullptr && session->kind == EditKind::Overwrite && session->positions.size() == 1) {
+        HerixLib::FilePosition start = session->positions[0];
+        if (source_pos >= start && source_pos <= start + session->length) {
+            if (source_pos == start + session->length) {
+                // Its span grows, so it's put back into the index under the new one
+                indexRecord(records.size() - 1, false);
+                session->data.push_back(value);
+                session->length++;
+                resident_record_bytes++;
+                indexRecord(records.size() - 1, true);
+            } else {
+                session->data[source_pos - start] = value;
+            }
+            session->changed_start = std::min(session->changed_start, pos);
+            session->changed_end = std::max(session->changed_end, pos + 1);
+            version++;
+            enforceMemoryBudget();
+            return;
+        }
+    }
+
+    EditRecord record;
+    record.positions.push_back(source_pos);
+    record.length = 1;
+    record.data.push_back(value);
+    record.changed_start = pos;
+    record.changed_end = pos + 1;
+    push(std::move(record));
+    session_open = true;
+    enforceMemoryBudget();
+}
+void EditLayer::insert (HerixLib::FilePosition pos, const std::vector<HerixLib::Byte>& bytes) {
+    const size_t file_end = getFileEnd();
+    if (bytes.empty() || pos > file_end) {
+        return;
+    }
+
+    EditRecord* session = getSessionRecord();
+    if (session != nullptr && session->kind == EditKind::Layout && session->removed.empty() && session->inserted.size() == 1) {
+        Piece& piece = session->inserted[0];
+        // Only if its bytes are at the end of the buffer, so they can just be appended to
+        if (pos == session->layout_pos + piece.length && piece.offset + piece.length == getAddedLength()) {
+            added.insert(added.end(), bytes.begin(), bytes.end());
+            Piece longer = piece;
+            longer.length += bytes.size();
+            table.replace(session->layout_pos, piece.length, {longer});
+            piece = longer;
+            session->changed_end = getFileEnd();
+            version++;
+            enforceMemoryBudget();
+            return;
+        }
+    }
+
+    Piece piece{PieceSource::Added, getAddedLength(), bytes.size()};
+    added.insert(added.end(), bytes.begin(), bytes.end());
+
+    EditRecord record;
+    record.kind = EditKind::Layout;
+    record.layout_pos = pos;
+    record.removed = table.replace(pos, 0, {piece});
+    record.inserted.push_back(piece);
+    record.changed_start = pos;
+    record.changed_end = getFileEnd();
+    push(std::move(record));
+    session_open = true;
+    enforceMemoryBudget();
+}
+void EditLayer::erase (HerixLib::FilePosition pos, size_t length) {
+    const size_t file_end = getFileEnd();
+    if (length == 0 || pos >= file_end) {
+        return;
+    }
+    length = std::min(length, file_end - pos);
+
+    EditRecord record;
+    record.kind = EditKind::Layout;
+    record.layout_pos = pos;
+    record.removed = table.replace(pos, length, {});
+    record.changed_start = pos;
+    record.changed_end = file_end;
+    push(std::move(record));
+}
+void EditLayer::endEditSession () {
+    session_open = false;
+    journalRecords(records.size());
+}
+void EditLayer::replaceRuns (std::vector<HerixLib::FilePosition> positions, std::vector<HerixLib::Byte> value) {
+    if (positions.empty() || value.empty()) {
+        return;
+    }
+    const size_t length = value.size();
+
+    EditRecord record;
+    record.length = length;
+    record.changed_start = positions.front();
+    record.changed_end = positions.back() + length;
+
+    // Matches which cross from one piece into another, each part of which becomes its own run
+    std::vector<EditRecord> crossing;
+    if (layout_records == 0) {
+        record.positions = std::move(positions);
+    } else {
+        record.positions.reserve(positions.size());
+        for (HerixLib::FilePosition pos : positions) {
+            auto [source_pos, piece_rest] = toSource(pos);
+            if (piece_rest >= length) {
+                record.positions.push_back(source_pos);
+                continue;
+            }
+
+            for (size_t done = 0; done < length;) {
+                auto [part_pos, part_rest] = toSource(pos + done);
+                size_t part_length = std::min(part_rest, length - done);
+
+                EditRecord part;
+                part.positions.push_back(part_pos);
+                part.length = part_length;
+                part.data.assign(value.begin() + static_cast<std::ptrdiff_t>(done), value.begin() + static_cast<std::ptrdiff_t>(done + part_length));
+                part.changed_start = pos + done;
+                part.changed_end = pos + done + part_length;
+                crossing.push_back(std::move(part));
+                done += part_length;
+            }
+        }
+        // The pieces can be in any order in the sources
+        std::sort(record.positions.begin(), record.positions.end());
+    }
+    record.data = std::move(value);
+
+    bool first = true;
+    if (!record.positions.empty()) {
+        push(std::move(record));
+        first = false;
+    }
+    for (EditRecord& part : crossing) {
+        part.joined = !first;
+        push(std::move(part));
+        first = false;
+    }
+    enforceMemoryBudget();
+}
+
+void EditLayer::fillRange (HerixLib::FilePosition pos, size_t length, std::vector<HerixLib::Byte> pattern) {
+    const size_t file_end = getFileEnd();
+    if (pattern.empty() || pos >= file_end) {
+        return;
+    }
+
+    EditRecord prototype;
+    prototype.source = EditSource::Pattern;
+    prototype.data = std::move(pattern);
+    pushRange(pos, std::min(length, file_end - pos), prototype);
+    enforceMemoryBudget();
+}
+void EditLayer::pasteFromFile (const std::filesystem::path& path, uint64_t source_offset, HerixLib::FilePosition pos, size_t length) {
+    const size_t file_end = getFileEnd();
+    if (pos >= file_end) {
+        return;
+    }
+
+    EditRecord prototype;
+    prototype.source = EditSource::File;
+    prototype.paste_file = std::make_shared<PasteFile>(path);
+    prototype.paste_offset = source_offset;
+    const uint64_t source_size = prototype.paste_file->getSize();
+    if (source_offset >= source_size) {
+        return;
+    }
+    length = std::min({length, file_end - pos, static_cast<size_t>(source_size - source_offset)});
+
+    std::error_code error;
+    if (!std::filesystem::equivalent(path, filename, error)) {
+        pushRange(pos, length, prototype);
+        return;
+    }
+
+    // Saving writes into this file one extent at a time, so reading the paste out of it then could get bytes that
+    // were already written over. They're copied now instead, while they're still what's shown.
+    for (size_t done = 0; done < length;) {
+        auto [part_pos, part_rest] = toSource(pos + done);
+        size_t part_length = std::min({part_rest, length - done, SELF_PASTE_RECORD_SIZE});
+
+        EditRecord part;
+        part.positions.push_back(part_pos);
+        part.length = part_length;
+        part.data.resize(part_length);
+        prototype.paste_file->read(source_offset + done, part.data.data(), part_length);
+        part.changed_start = pos + done;
+        part.changed_end = pos + done + part_length;
+        part.joined = done != 0;
+        push(std::move(part));
+        enforceMemoryBudget();
+        done += part_length;
+    }
+}
+
+std::optional<EditChange> EditLayer::undo () {
+    endEditSession();
+    if (applied == 0) {
+        return std::nullopt;
+    }
+
+    EditChange change;
+    HerixLib::FilePosition change_end = 0;
+    size_t count = 0;
+    bool joined = true;
+    while (joined && applied > 0) {
+        applied--;
+        const EditRecord& record = records[applied];
+        if (record.kind == EditKind::Layout) {
+            applyLayout(record, true);
+            change.layout_changed = true;
+        } else {
+            indexRecord(applied, false);
+        }
+
+        change.start = count == 0 ? record.changed_start : std::min(change.start, record.changed_start);
+        change_end = std::max(change_end, record.changed_end);
+        joined = record.joined;
+        count++;
+    }
+    change.length = change_end - change.start;
+    if (count == 1 && !change.layout_changed && layout_records == 0) {
+        change.runs = &records[applied];
+    }
+
+    version++;
+    return change;
+}
+std::optional<EditChange> EditLayer::redo () {
+    endEditSession();
+    if (applied == records.size()) {
+        return std::nullopt;
+    }
+
+    EditChange change;
+    HerixLib::FilePosition change_end = 0;
+    size_t count = 0;
+    do {
+        const EditRecord& record = records[applied];
+        applied++;
+        if (record.kind == EditKind::Layout) {
+            applyLayout(record, false);
+            change.layout_changed = true;
+        } else {
+            indexRecord(applied - 1, true);
+        }
+
+        change.start = count == 0 ? record.changed_start : std::min(change.start, record.changed_start);
+        change_end = std::max(change_end, record.changed_end);
+        count++;
+    } while (applied < records.size() && records[applied].joined);
+    change.length = change_end - change.start;
+    if (count == 1 && !change.layout_changed && layout_records == 0) {
+        change.runs = &records[applied - 1];
+    }
+
+    version++;
+    return change;
+}
+
+bool EditLayer::hasUnsavedEdits () const {
+    return saved_applied != applied;
+}
+bool EditLayer::hasLayoutChanges () const {
+    return layout_records != 0;
+}
+
+SaveStats EditLayer::saveHistoryDestructive (bool journaled) {
+    if (!allow_writing) {
+        throw std::runtime_error("File was opened in read only mode.");
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    SaveStats stats;
+    stats.journaled = journaled;
+
+    if (layout_records != 0) {
+        // Everything after the first insertion/deletion moved, so the whole file has to be written anyway
+        SaveStats layout_stats = saveLayout();
+        layout_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        return layout_stats;
+    }
+
+    std::vector<std::pair<HerixLib::FilePosition, size_t>> extents = getDirtyExtents();
+    const std::filesystem::path journal_path = getJournalPath(filename);
+    if (journaled) {
+        writeJournal(journal_path, extents);
+    }
+
+    int fd = ::open(filename.c_str(), O_WRONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not open file for writing: ") + std::strerror(errno));
+    }
+
+    try {
+        std::vector<HerixLib::Byte> buffer;
+        for (const auto& [extent_start, extent_length] : extents) {
+            for (size_t done = 0; done < extent_length; done += SAVE_WRITE_SIZE) {
+                size_t size = std::min(SAVE_WRITE_SIZE, extent_length - done);
+                // Every byte of an extent is covered by a record, so the file doesn't need to be read
+                buffer.assign(size, 0);
+                applyRecords(extent_start + done, buffer.data(), size);
+                writeAll(fd, buffer.data(), size, static_cast<off_t>(file_range.first + extent_start + done));
+            }
+            stats.bytes += extent_length;
+            stats.extents++;
+        }
+
+        // Only once, rather than for every write
+        syncFile(fd, "file");
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    if (journaled) {
+        // The file has everything now, so there's nothing left to replay
+        std::filesystem::remove(journal_path);
+        syncDirectory(journal_path);
+    }
+
+    // Herix has parts of the old contents cached
+    reopen();
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return stats;
+}
+
+SaveStats EditLayer::saveLayout () {
+    SaveStats stats;
+    stats.extents = 1;
+
+    struct stat original_stat;
+    if (stat(filename.c_str(), &original_stat) != 0) {
+        throw std::runtime_error(std::string("Could not stat file: ") + std::strerror(errno));
+    }
+    const uint64_t original_size = static_cast<uint64_t>(original_stat.st_size);
+
+    std::filesystem::path temp_path = filename;
+    temp_path += ".herix-save";
+    int original_fd = ::open(filename.c_str(), O_RDONLY);
+    if (original_fd < 0) {
+        throw std::runtime_error(std::string("Could not open file for reading: ") + std::strerror(errno));
+    }
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, original_stat.st_mode & 07777);
+    if (fd < 0) {
+        close(original_fd);
+        throw std::runtime_error(std::string("Could not create file to save into: ") + std::strerror(errno));
+    }
+
+    const size_t content_length = getFileEnd();
+    try {
+        off_t out_offset = 0;
+        std::vector<HerixLib::Byte> buffer;
+        // The parts outside of the opened range are copied as they are
+        auto copyRaw = [&] (uint64_t from, uint64_t to) {
+            while (from < to) {
+                buffer.resize(static_cast<size_t>(std::min<uint64_t>(SAVE_WRITE_SIZE, to - from)));
+                ssize_t amount = pread(original_fd, buffer.data(), buffer.size(), static_cast<off_t>(from));
+                if (amount < 0 && errno == EINTR) {
+                    continue;
+                } else if (amount <= 0) {
+                    throw std::runtime_error(std::string("Failed reading file: ") + std::strerror(errno));
+                }
+                writeAll(fd, buffer.data(), static_cast<size_t>(amount), out_offset);
+                out_offset += amount;
+                from += static_cast<uint64_t>(amount);
+            }
+        };
+
+        copyRaw(0, std::min<uint64_t>(file_range.first, original_size));
+        for (size_t done = 0; done < content_length; done += SAVE_WRITE_SIZE) {
+            std::vector<HerixLib::Byte> data = readMultipleCutoff(done, std::min(SAVE_WRITE_SIZE, content_length - done));
+            writeAll(fd, data.data(), data.size(), out_offset);
+            out_offset += static_cast<off_t>(data.size());
+        }
+        if (file_range.second.has_value()) {
+            copyRaw(std::min<uint64_t>(file_range.second.value(), original_size), original_size);
+        }
+
+        syncFile(fd, "saved file");
+    } catch (...) {
+        close(fd);
+        close(original_fd);
+        std::filesystem::remove(temp_path);
+        throw;
+    }
+    close(fd);
+    close(original_fd);
+
+    if (rename(temp_path.c_str(), filename.c_str()) != 0) {
+        int error = errno;
+        std::filesystem::remove(temp_path);
+        throw std::runtime_error(std::string("Could not replace file: ") + std::strerror(error));
+    }
+    syncDirectory(filename);
+
+    if (file_range.second.has_value()) {
+        file_range.second = file_range.first + content_length;
+    }
+    stats.bytes = content_length;
+    reopen();
+    return stats;
+}
+
+std::filesystem::path EditLayer::getJournalPath (const std::filesystem::path& filename) {
+    std::filesystem::path journal_path = filename;
+    journal_path += ".herix-journal";
+    return journal_path;
+}
+
+JournalRecovery EditLayer::recoverJournal (const std::filesystem::path& filename) {
+    const std::filesystem::path journal_path = getJournalPath(filename);
+    if (!std::filesystem::exists(journal_path)) {
+        return JournalRecovery::None;
+    }
+
+    // An incomplete journal means the save never got to writing the file
+    if (!readJournal(journal_path, true, [] (uint64_t, const HerixLib::Byte*, size_t) {})) {
+        std::filesystem::remove(journal_path);
+        syncDirectory(journal_path);
+        return JournalRecovery::Discarded;
+    }
+
+    int fd = ::open(filename.c_str(), O_WRONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not open file to finish an interrupted save: ") + std::strerror(errno));
+    }
+    try {
+        // Writing the same bytes again is harmless, so it doesn't matter how far the save got
+        readJournal(journal_path, false, [fd] (uint64_t offset, const HerixLib::Byte* data, size_t size) {
+            writeAll(fd, data, size, static_cast<off_t>(offset));
+        });
+        syncFile(fd, "file");
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    std::filesystem::remove(journal_path);
+    syncDirectory(journal_path);
+    return JournalRecovery::Replayed;
+}
+
+uint64_t EditLayer::getVersion () const {
+    return version;
+}
+
+void EditLayer::setMemoryBudget (size_t bytes) {
+    memory_budget = bytes;
+}
+EditMemoryStats EditLayer::getMemoryStats () const {
+    EditMemoryStats stats;
+    stats.resident = resident_record_bytes + added.size();
+    stats.spilled = spilled_record_bytes + added_spilled;
+    return stats;
+}
+
+size_t EditLayer::getAddedLength () const {
+    return added_spilled + added.size();
+}
+void EditLayer::readAdded (uint64_t offset, HerixLib::Byte* out, size_t size) const {
+    if (offset < added_spilled) {
+        size_t spilled_part = std::min(size, static_cast<size_t>(added_spilled - offset));
+        added_spill.read(offset, out, spilled_part);
+        offset += spilled_part;
+        out += spilled_part;
+        size -= spilled_part;
+        if (size == 0) {
+            return;
+        }
+    }
+    auto start = added.begin() + static_cast<std::ptrdiff_t>(offset - added_spilled);
+    std::copy(start, start + static_cast<std::ptrdiff_t>(size), out);
+}
+
+void EditLayer::enforceMemoryBudget () {
+    if (memory_budget == 0 || getMemoryStats().resident <= memory_budget) {
+        return;
+    }
+    const size_t target = memory_budget / 2;
+
+    // The record the session is adding to stays in memory
+    const size_t record_limit = (session_open && !records.empty()) ? records.size() - 1 : records.size();
+    for (; spill_scan < record_limit && getMemoryStats().resident > target; spill_scan++) {
+        EditRecord& record = records[spill_scan];
+        // Small ones are about as large as their index, so there's little to gain
+        if (record.spill_offset.has_value() || record.data.size() < MIN_SPILL_SIZE) {
+            continue;
+        }
+
+        record.spill_offset = record_spill.append(record.data.data(), record.data.size());
+        record.spilled_size = record.data.size();
+        resident_record_bytes -= record.data.size();
+        spilled_record_bytes += record.data.size();
+        record.data.clear();
+        record.data.shrink_to_fit();
+    }
+
+    if (getMemoryStats().resident <= target) {
+        return;
+    }
+    // Everything inserted before the piece the session is adding to
+    size_t added_limit = getAddedLength();
+    const EditRecord* session = (session_open && !records.empty()) ? &records.back() : nullptr;
+    if (session != nullptr && session->kind == EditKind::Layout && !session->inserted.empty()) {
+        added_limit = std::min<size_t>(added_limit, session->inserted.front().offset);
+    }
+    if (added_limit > added_spilled) {
+        size_t amount = added_limit - added_spilled;
+        added_spill.append(added.data(), amount);
+        added.erase(added.begin(), added.begin() + static_cast<std::ptrdiff_t>(amount));
+        added.shrink_to_fit();
+        added_spilled = added_limit;
+    }
+}
+
+size_t EditLayer::openHistory (const std::filesystem::path& path) {
+    const std::string fingerprint = getFingerprint();
+    journal.open(path, fingerprint);
+    journaled_records = 0;
+
+    std::vector<EditRecord> restored;
+    std::vector<HerixLib::Byte> restored_added;
+    try {
+        for (const auto& [entry_offset, entry_size] : journal.getOpenedEntries()) {
+            EntryReader reader{journal.getData(entry_offset, entry_size), entry_size};
+            EditRecord record;
+            size_t index = static_cast<size_t>(reader.readValue());
+            record.kind = *reader.take(1) == 0 ? EditKind::Overwrite : EditKind::Layout;
+            record.joined = *reader.take(1) != 0;
+            record.length = static_cast<size_t>(reader.readValue());
+            record.layout_pos = reader.readValue();
+            record.changed_start = reader.readValue();
+            record.changed_end = reader.readValue();
+            record.positions.resize(static_cast<size_t>(reader.readValue()));
+            for (HerixLib::FilePosition& pos : record.positions) {
+                pos = reader.readValue();
+            }
+            record.removed = reader.readPieces();
+            record.inserted = reader.readPieces();
+            // The inserted bytes are needed for reading, so they go back into memory
+            for (const Piece& piece : record.inserted) {
+                if (piece.source == PieceSource::Added) {
+                    const HerixLib::Byte* bytes = reader.take(piece.length);
+                    restored_added.resize(std::max<size_t>(restored_added.size(), piece.offset + piece.length));
+                    std::copy(bytes, bytes + piece.length, restored_added.begin() + static_cast<std::ptrdiff_t>(piece.offset));
+                }
+            }
+            record.source = static_cast<EditSource>(*reader.take(1));
+            if (record.source == EditSource::File) {
+                size_t path_size = static_cast<size_t>(reader.readValue());
+                const HerixLib::Byte* path_data = reader.take(path_size);
+                // Throws if the file is gone, which drops the history
+                record.paste_file = std::make_shared<PasteFile>(std::string(path_data, path_data + path_size));
+                record.paste_offset = reader.readValue();
+            }
+            record.spilled_size = static_cast<size_t>(reader.readValue());
+            reader.take(record.spilled_size);
+            if (record.spilled_size != 0) {
+                record.spill_offset = entry_offset + entry_size - record.spilled_size;
+                record.in_journal = true;
+            }
+
+            // Each entry was written at the index it had, which dropped everything that could be redone
+            if (index > restored.size()) {
+                throw std::runtime_error("Undo history entry is out of order.");
+            }
+            restored.resize(index);
+            restored.push_back(std::move(record));
+        }
+    } catch (const std::runtime_error&) {
+        // Better to lose the history than to restore part of it wrong
+        journal.reset(fingerprint);
+        return 0;
+    }
+
+    records = std::move(restored);
+    added = std::move(restored_added);
+    for (const EditRecord& record : records) {
+        spilled_record_bytes += record.spilled_size;
+    }
+    journaled_records = records.size();
+    version++;
+    return records.size();
+}
+
+std::string EditLayer::getFingerprint () {
+    const size_t length = base.getFileEnd();
+    Hasher hasher(HashAlgorithm::XXH64);
+    const HerixLib::FilePosition samples[] = {0, length / 2, length - std::min(length, FINGERPRINT_SAMPLE_SIZE)};
+    for (HerixLib::FilePosition pos : samples) {
+        std::vector<HerixLib::Byte> data = base.readMultipleCutoff(pos, FINGERPRINT_SAMPLE_SIZE);
+        hasher.update(data.data(), data.size());
+    }
+
+    // A patch of the same size outside of the samples wouldn't change them, so the file also has to be the same one,
+    // not written to since. Saving changes these too, which is when the history is started over anyway.
+    std::string identity;
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) == 0) {
+        identity = std::to_string(file_stat.st_ino) + ":" + std::to_string(file_stat.st_mtim.tv_sec) + "." +
+            std::to_string(file_stat.st_mtim.tv_nsec) + ":";
+    }
+    return identity + std::to_string(length) + ":" + hasher.finish();
+}
+
+void EditLayer::journalRecords (size_t end) {
+    if (!journal.isOpen()) {
+        return;
+    }
+
+    try {
+        std::vector<HerixLib::Byte> payload;
+        std::vector<HerixLib::Byte> scratch;
+        for (; journaled_records < end; journaled_records++) {
+            EditRecord& record = records[journaled_records];
+            payload.clear();
+            appendValue(payload, journaled_records);
+            payload.push_back(static_cast<HerixLib::Byte>(record.kind));
+            payload.push_back(record.joined ? 1 : 0);
+            appendValue(payload, record.length);
+            appendValue(payload, record.layout_pos);
+            appendValue(payload, record.changed_start);
+            appendValue(payload, record.changed_end);
+            appendValue(payload, record.positions.size());
+            for (HerixLib::FilePosition pos : record.positions) {
+                appendValue(payload, pos);
+            }
+            appendPieces(payload, record.removed);
+            appendPieces(payload, record.inserted);
+            for (const Piece& piece : record.inserted) {
+                if (piece.source == PieceSource::Added) {
+                    size_t start = payload.size();
+                    payload.resize(start + piece.length);
+                    readAdded(piece.offset, payload.data() + start, piece.length);
+                }
+            }
+            payload.push_back(static_cast<HerixLib::Byte>(record.source));
+            if (record.source == EditSource::File) {
+                const std::string path = record.paste_file->getPath().string();
+                appendValue(payload, path.size());
+                payload.insert(payload.end(), path.begin(), path.end());
+                appendValue(payload, record.paste_offset);
+            }
+            // Last, so where it is in the journal is known from the end of the entry
+            const size_t data_size = record.getDataSize();
+            appendValue(payload, data_size);
+            const HerixLib::Byte* data = getRecordData(record, 0, data_size, scratch);
+            payload.insert(payload.end(), data, data + data_size);
+
+            uint64_t entry_offset = journal.append(payload);
+            if (!record.spill_offset.has_value() && data_size != 0) {
+                record.spill_offset = entry_offset + payload.size() - data_size;
+                record.spilled_size = data_size;
+                record.in_journal = true;
+                resident_record_bytes -= data_size;
+                spilled_record_bytes += data_size;
+                record.data.clear();
+                record.data.shrink_to_fit();
+            }
+        }
+    } catch (const std::runtime_error&) {
+        // The records already in it are brought back into memory, since the journal is going away
+        std::vector<HerixLib::Byte> scratch;
+        for (EditRecord& record : records) {
+            if (record.in_journal) {
+                const HerixLib::Byte* data = getRecordData(record, 0, record.spilled_size, scratch);
+                record.data.assign(data, data + record.spilled_size);
+                resident_record_bytes += record.spilled_size;
+                spilled_record_bytes -= record.spilled_size;
+                record.spill_offset = std::nullopt;
+                record.spilled_size = 0;
+                record.in_journal = false;
+            }
+        }
+        journal = UndoJournal();
+        journaled_records = 0;
+    }
+}
+
+const HerixLib::Byte* EditLayer::getRecordData (const EditRecord& record, size_t offset, size_t size, std::vector<HerixLib::Byte>& scratch) const {
+    if (!record.spill_offset.has_value()) {
+        return record.data.data() + offset;
+    } else if (record.in_journal) {
+        return journal.getData(record.spill_offset.value() + offset, size);
+    }
+    scratch.resize(size);
+    record_spill.read(record.spill_offset.value() + offset, scratch.data(), size);
+    return scratch.data();
+}
+
+void EditLayer::reopen () {
+    base = HerixLib::Herix(filename, allow_writing, file_range, max_chunk_memory, max_chunk_size);
+    table = PieceTable(base.getFileEnd());
+    added.clear();
+    added_spilled = 0;
+    added_spill.clear();
+    records.clear();
+    record_index.clear();
+    resident_record_bytes = 0;
+    spilled_record_bytes = 0;
+    spill_scan = 0;
+    record_spill.clear();
+    journaled_records = 0;
+    if (journal.isOpen()) {
+        try {
+            journal.reset(getFingerprint());
+        } catch (const std::runtime_error&) {
+            // Nothing refers to it anymore, so it can just be dropped
+            journal = UndoJournal();
+        }
+    }
+    layout_records = 0;
+    applied = 0;
+    saved_applied = 0;
+    session_open = false;
+    version++;
+}
+
+EditRecord* EditLayer::getSessionRecord () {
+    if (!session_open || applied == 0 || applied != records.size()) {
+        return nullptr;
+    }
+    // Changing a saved record would make the file look saved when it isn't
+    if (saved_applied.has_value() && saved_applied.value() == applied) {
+        return nullptr;
+    }
+    return &records.back();
+}
+
+void EditLayer::push (EditRecord record) {
+    session_open = false;
+    // Anything that was undone can't be redone after a new edit. What they spilled stays in the file until it's
+    // cleared on saving.
+    for (size_t r = applied; r < records.size(); r++) {
+        if (records[r].spill_offset.has_value()) {
+            spilled_record_bytes -= records[r].spilled_size;
+        } else {
+            resident_record_bytes -= records[r].data.size();
+        }
+    }
+    records.resize(applied);
+    spill_scan = std::min(spill_scan, records.size());
+    journaled_records = std::min(journaled_records, records.size());
+    // The new record ends the session, so none of the ones before it can change anymore
+    journalRecords(records.size());
+    if (saved_applied.has_value() && saved_applied.value() > applied) {
+        saved_applied = std::nullopt;
+    }
+
+    if (record.kind == EditKind::Layout) {
+        layout_records++;
+    }
+    resident_record_bytes += record.data.size();
+    records.push_back(std::move(record));
+    applied++;
+    if (records.back().kind == EditKind::Overwrite) {
+        indexRecord(applied - 1, true);
+    }
+    version++;
+}
+
+void EditLayer::indexRecord (size_t index, bool adding) {
+    const EditRecord& record = records[index];
+    if (record.positions.empty()) {
+        return;
+    }
+    HerixLib::FilePosition start = record.positions.front();
+    HerixLib::FilePosition end = record.positions.back() + record.length;
+    if (adding) {
+        record_index.add(index, start, end);
+    } else {
+        record_index.remove(index, start, end);
+    }
+}
+
+void EditLayer::pushRange (HerixLib::FilePosition pos, size_t length, const EditRecord& prototype) {
+    // A piece is contiguous in source space, so each one the range covers is a single run
+    for (size_t done = 0; done < length;) {
+        auto [part_pos, part_rest] = toSource(pos + done);
+        size_t part_length = std::min(part_rest, length - done);
+
+        EditRecord part = prototype;
+        part.positions.push_back(part_pos);
+        part.length = part_length;
+        part.changed_start = pos + done;
+        part.changed_end = pos + done + part_length;
+        part.joined = done != 0;
+        if (part.source == EditSource::Pattern) {
+            std::rotate(part.data.begin(), part.data.begin() + static_cast<std::ptrdiff_t>(done % part.data.size()), part.data.end());
+        } else if (part.source == EditSource::File) {
+            part.paste_offset += done;
+        }
+        push(std::move(part));
+        done += part_length;
+    }
+}
+
+std::pair<HerixLib::FilePosition, size_t> EditLayer::toSource (HerixLib::FilePosition pos) const {
+    if (layout_records == 0) {
+        return {pos, table.getLength() - std::min(pos, table.getLength())};
+    }
+    Piece piece = table.find(pos);
+    if (piece.source == PieceSource::Added) {
+        return {ADDED_SOURCE + piece.offset, piece.length};
+    }
+    return {piece.offset, piece.length};
+}
+
+void EditLayer::applyLayout (const EditRecord& record, bool undoing) {
+    if (undoing) {
+        table.replace(record.layout_pos, record.getInsertedLength(), record.removed);
+        layout_records--;
+    } else {
+        table.replace(record.layout_pos, record.getRemovedLength(), record.inserted);
+        layout_records++;
+    }
+}
+
+std::vector<std::pair<HerixLib::FilePosition, size_t>> EditLayer::getDirtyExtents () const {
+    std::vector<std::pair<HerixLib::FilePosition, size_t>> runs;
+    for (size_t r = 0; r < applied; r++) {
+        for (HerixLib::FilePosition pos : records[r].positions) {
+            runs.emplace_back(pos, records[r].length);
+        }
+    }
+    std::sort(runs.begin(), runs.end());
+
+    std::vector<std::pair<HerixLib::FilePosition, size_t>> extents;
+    for (const auto& [pos, length] : runs) {
+        if (!extents.empty() && pos <= extents.back().first + extents.back().second) {
+            HerixLib::FilePosition end = std::max(extents.back().first + extents.back().second, pos + length);
+            extents.back().second = end - extents.back().first;
+        } else {
+            extents.emplace_back(pos, length);
+        }
+    }
+    return extents;
+}
+
+void EditLayer::writeJournal (const std::filesystem::path& journal_path,
+    const std::vector<std::pair<HerixLib::FilePosition, size_t>>& extents) const {
+    int fd = ::open(journal_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not create save journal: ") + std::strerror(errno));
+    }
+
+    try {
+        Hasher hasher(HashAlgorithm::XXH64);
+        off_t offset = 0;
+        auto append = [&] (const void* data, size_t size) {
+            writeAll(fd, reinterpret_cast<const HerixLib::Byte*>(data), size, offset);
+            hasher.update(reinterpret_cast<const HerixLib::Byte*>(data), size);
+            offset += static_cast<off_t>(size);
+        };
+
+        append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        std::vector<HerixLib::Byte> buffer;
+        for (const auto& [extent_start, extent_length] : extents) {
+            for (size_t done = 0; done < extent_length; done += SAVE_WRITE_SIZE) {
+                uint64_t entry_offset = file_range.first + extent_start + done;
+                uint64_t entry_length = std::min(SAVE_WRITE_SIZE, extent_length - done);
+                buffer.assign(entry_length, 0);
+                applyRecords(extent_start + done, buffer.data(), buffer.size());
+
+                append(&entry_offset, sizeof(entry_offset));
+                append(&entry_length, sizeof(entry_length));
+                append(buffer.data(), buffer.size());
+            }
+        }
+        uint64_t end_offset = JOURNAL_END;
+        uint64_t end_length = 0;
+        append(&end_offset, sizeof(end_offset));
+        append(&end_length, sizeof(end_length));
+
+        std::string digest = hasher.finish();
+        writeAll(fd, reinterpret_cast<const HerixLib::Byte*>(digest.data()), digest.size(), offset);
+        syncFile(fd, "save journal");
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    syncDirectory(journal_path);
+}
+
+void EditLayer::applyRecords (HerixLib::FilePosition pos, HerixLib::Byte* data, size_t size) const {
+    if (size == 0) {
+        return;
+    }
+    const HerixLib::FilePosition end = pos + size;
+
+    // Only the records whose span overlaps the range, oldest first
+    std::vector<size_t> overlapping;
+    record_index.find(pos, end, overlapping);
+
+    std::vector<HerixLib::Byte> spill_buffer;
+    for (size_t r : overlapping) {
+        const EditRecord& record = records[r];
+
+        // Since the runs don't overlap, only the one right before the first run starting after pos can reach it
+        auto it = std::upper_bound(record.positions.begin(), record.positions.end(), pos);
+        if (it != record.positions.begin() && *(it - 1) + record.length > pos) {
+            --it;
+        }
+
+        auto last = std::lower_bound(it, record.positions.end(), end);
+        if (it == last) {
+            continue;
+        }
+
+        if (record.source != EditSource::Bytes) {
+            // These are a single run
+            HerixLib::FilePosition run_start = std::max(*it, pos);
+            HerixLib::FilePosition run_end = std::min(*it + record.length, end);
+            if (record.source == EditSource::Pattern) {
+                const HerixLib::Byte* pattern = getRecordData(record, 0, record.getDataSize(), spill_buffer);
+                repeatPattern(pattern, record.getDataSize(), run_start - *it, data + (run_start - pos), run_end - run_start);
+            } else {
+                record.paste_file->read(record.paste_offset + (run_start - *it), data + (run_start - pos), run_end - run_start);
+            }
+            continue;
+        }
+
+        // One read for all of the runs in the range, since they're next to each other in the data
+        size_t data_start = record.getRunOffset(static_cast<size_t>(it - record.positions.begin()));
+        size_t data_end = record.getRunOffset(static_cast<size_t>(last - record.positions.begin()) - 1) + record.length;
+        const HerixLib::Byte* record_data = getRecordData(record, data_start, data_end - data_start, spill_buffer);
+
+        for (; it != last; ++it) {
+            size_t index = static_cast<size_t>(it - record.positions.begin());
+            HerixLib::FilePosition run_start = std::max(*it, pos);
+            HerixLib::FilePosition run_end = std::min(*it + record.length, end);
+            const HerixLib::Byte* source = record_data + (record.getRunOffset(index) - data_start) + (run_start - *it);
+            std::copy(source, source + (run_end - run_start), data + (run_start - pos));
+        }
+    }
+}
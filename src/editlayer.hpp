@@ -0,0 +1,287 @@
+#ifndef FILE_SEEN_EDITLAYER
+#define FILE_SEEN_EDITLAYER
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include "./Herix/src/herix.hpp"
+#include "./piecetable.hpp"
+#include "./spillfile.hpp"
+#include "./undojournal.hpp"
+#include "./recordindex.hpp"
+
+enum class EditKind : uint8_t {
+    // Bytes changed in place
+    Overwrite,
+    // Bytes inserted and/or removed, moving everything after them
+    Layout,
+};
+
+// Where the bytes of an overwrite come from
+enum class EditSource : uint8_t {
+    // The record's data, one way or another, see EditRecord
+    Bytes,
+    // A single run of the record's data repeated for as long as it is
+    Pattern,
+    // A single run read out of another file
+    File,
+};
+
+// A file which an overwrite reads its bytes from, kept open for as long as a record refers to it.
+class PasteFile {
+    public:
+    // Throws std::runtime_error if it can't be opened
+    explicit PasteFile (const std::filesystem::path& t_path);
+    PasteFile (const PasteFile&) = delete;
+    PasteFile& operator= (const PasteFile&) = delete;
+    ~PasteFile ();
+
+    const std::filesystem::path& getPath () const;
+    uint64_t getSize () const;
+    // Past the end of the file (if it shrunk since) reads as zeroes.
+    void read (uint64_t offset, HerixLib::Byte* out, size_t size) const;
+
+    private:
+    std::filesystem::path path;
+    int fd = -1;
+};
+
+// One undoable change.
+// An overwrite is the same amount of bytes replaced at each of a list of positions. A typed byte is a single run,
+// while a replace-all is every match sharing one copy of the replacement, so its size depends on the amount of
+// matches rather than the amount of bytes.
+// A layout change replaces a range of the piece table, and keeps the pieces from both sides of it, so it only takes
+// memory for the pieces rather than for the bytes that moved.
+struct EditRecord {
+    EditKind kind = EditKind::Overwrite;
+
+    // Overwrite: the positions are in source space (see EditLayer) rather than file positions, so that insertions
+    // and deletions before them don't move them.
+    // Sorted, and the runs never overlap
+    std::vector<HerixLib::FilePosition> positions;
+    size_t length = 0;
+    // Either length bytes which every run is set to, or positions.size() * length bytes, one run after another.
+    // Empty once moved out to the spill file or the undo journal, see EditLayer.
+    std::vector<HerixLib::Byte> data;
+    std::optional<uint64_t> spill_offset;
+    size_t spilled_size = 0;
+    // If spill_offset is in the undo journal rather than the spill file
+    bool in_journal = false;
+    // Pattern: data is the pattern, already lined up so that it starts at the start of the run.
+    // File: data is empty, and the run is read from paste_offset on in paste_file.
+    EditSource source = EditSource::Bytes;
+    std::shared_ptr<PasteFile> paste_file;
+    uint64_t paste_offset = 0;
+
+    // Layout: [layout_pos, layout_pos + length of removed) became the inserted pieces
+    HerixLib::FilePosition layout_pos = 0;
+    std::vector<Piece> removed;
+    std::vector<Piece> inserted;
+
+    // The part of the file it changed when it was made, which is also the layout whenever it is undone/redone
+    HerixLib::FilePosition changed_start = 0;
+    HerixLib::FilePosition changed_end = 0;
+    // If it was made in the same operation as the record before it, so they're undone/redone together
+    bool joined = false;
+
+    size_t getDataSize () const;
+    // Offset of the run's bytes in the data
+    size_t getRunOffset (size_t index) const;
+    size_t getRemovedLength () const;
+    size_t getInsertedLength () const;
+};
+
+// What an undo/redo changed, so it can be redrawn/recomputed
+struct EditChange {
+    HerixLib::FilePosition start = 0;
+    size_t length = 0;
+    // If bytes were inserted/removed, in which case everything from start on moved
+    bool layout_changed = false;
+    // Set when it was a single overwrite made while nothing was inserted or removed, so its positions are also file
+    // positions, and each run can be handled on its own rather than the whole range.
+    const EditRecord* runs = nullptr;
+};
+
+// Bytes taken by edits, in memory and in the spill file
+struct EditMemoryStats {
+    size_t resident = 0;
+    size_t spilled = 0;
+};
+
+struct SaveStats {
+    // Bytes written, and how many separate writes that took
+    size_t bytes = 0;
+    size_t extents = 0;
+    double seconds = 0.0;
+    // If it went through a journal
+    bool journaled = false;
+};
+
+enum class JournalRecovery {
+    // There was no journal
+    None,
+    // A save was interrupted after its journal was complete, so it has been finished
+    Replayed,
+    // A save was interrupted while writing its journal, before the file was touched, so it was thrown away
+    Discarded,
+};
+
+// The edits made in the editor, kept on top of the file which Herix reads (which is left unedited until saving).
+// The layout of the file is a PieceTable over two sources: the original file, and a buffer of inserted bytes.
+// Overwrites are kept apart from it, in "source space": the original byte at offset n is at n, and the inserted
+// byte at offset n of the buffer is at ADDED_SOURCE + n. Reads assemble the pieces of the range, and apply the
+// overwrite records which overlap each piece (found through a RecordIndex), oldest first. Undoing an overwrite just stops applying it, and undoing a
+// layout change puts back the pieces it replaced, so nothing needs to remember what the bytes were before.
+// When the bytes held by edits go over the memory budget, the oldest ones are moved into an anonymous temporary
+// file: the data of large records, and the start of the inserted bytes. Positions and pieces stay in memory, so
+// finding what overlaps a read doesn't touch the disk, and a spilled record overlapping it is a single read.
+// With a history opened, each record is written to the undo journal once it can no longer change, and its data is
+// then read from there instead.
+// Has the same names for reading/editing as Herix, so the rest of the editor can use either.
+class EditLayer {
+    public:
+    static constexpr uint64_t ADDED_SOURCE = uint64_t(1) << 63;
+
+    bool allow_writing = false;
+
+    EditLayer ();
+    EditLayer (std::filesystem::path t_filename, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range,
+        HerixLib::ChunkSize t_max_chunk_memory, HerixLib::ChunkSize t_max_chunk_size);
+
+    std::optional<HerixLib::Byte> read (HerixLib::FilePosition pos);
+    std::vector<HerixLib::Byte> readMultipleCutoff (HerixLib::FilePosition pos, size_t length);
+    // Kept by the piece table, so it's cheap and never out of date
+    size_t getFileEnd ();
+    // Asks the OS to start reading the part of the file that [pos, pos + length) shows, without waiting for it.
+    // Only a hint, so nothing happens if it can't.
+    void prefetch (HerixLib::FilePosition pos, size_t length);
+
+    // Edits made one after another inside of an edit session are merged, as long as each is on or right after the
+    // run made so far. So typing out a patch is one record (and one undo step) with a byte per byte changed, rather
+    // than a record per nibble typed. Bytes inserted in the same session are changed directly.
+    void edit (HerixLib::FilePosition pos, HerixLib::Byte value);
+    // Insertions right after the previous one in the same session are merged as well.
+    void insert (HerixLib::FilePosition pos, const std::vector<HerixLib::Byte>& bytes);
+    void erase (HerixLib::FilePosition pos, size_t length);
+    // Following edits start a new record. Undoing, redoing, replacing and saving all end the session as well.
+    void endEditSession ();
+    // Sets the bytes at each of the file positions (sorted, and at least value.size() apart) to value, as one undo step.
+    void replaceRuns (std::vector<HerixLib::FilePosition> positions, std::vector<HerixLib::Byte> value);
+    // Sets [pos, pos + length) to the pattern repeated, as one undo step which only keeps the pattern.
+    // The range is cut off at the end of the file.
+    void fillRange (HerixLib::FilePosition pos, size_t length, std::vector<HerixLib::Byte> pattern);
+    // Sets [pos, pos + length) to the bytes of the file at path from source_offset on, as one undo step which reads
+    // them from that file when they're needed, so it shouldn't be changed before saving. The range is cut off at
+    // the end of either file. Throws std::runtime_error if it can't be opened.
+    void pasteFromFile (const std::filesystem::path& path, uint64_t source_offset, HerixLib::FilePosition pos, size_t length);
+
+    // Returns what changed, or nullopt if there was nothing to undo/redo.
+    // The runs in it are only valid until the next edit.
+    std::optional<EditChange> undo ();
+    std::optional<EditChange> redo ();
+
+    bool hasUnsavedEdits () const;
+    // If anything inserted or removed is applied
+    bool hasLayoutChanges () const;
+    // Writes the edits into the file and forgets the undo history. Throws std::runtime_error if writing fails.
+    // Without insertions/deletions only the edited bytes are written: runs that touch are joined into extents,
+    // which are written in order of offset and then synced once. So it takes about as long as the edits are large,
+    // no matter the file size. Otherwise the new layout is streamed into a temporary file next to it, which is then
+    // renamed over it.
+    // With journaled set (and the layout unchanged), the extents are first written to a journal next to the file
+    // (synced), then to the file, and then the journal is removed. If it's interrupted, recoverJournal finishes the
+    // save the next time the file is opened, so the file never stays half written.
+    SaveStats saveHistoryDestructive (bool journaled = false);
+
+    static std::filesystem::path getJournalPath (const std::filesystem::path& filename);
+    // Finishes (or throws away) a save that was interrupted. Should be called before the file is opened.
+    // Throws std::runtime_error if there's a journal that can't be replayed.
+    static JournalRecovery recoverJournal (const std::filesystem::path& filename);
+
+    // Changes whenever the contents do, so work done over several steps can tell if it is out of date.
+    uint64_t getVersion () const;
+
+    // Keeps the undo history in the journal at path from now on. If it has a history for the file as it currently
+    // is (compared by a fingerprint of its contents), that's restored, with every edit undone so they can be redone.
+    // Should be called before editing. Returns how many records were restored.
+    // Throws std::runtime_error if the journal can't be used.
+    size_t openHistory (const std::filesystem::path& path);
+
+    // 0 for no limit. Applies from the next edit on.
+    void setMemoryBudget (size_t bytes);
+    EditMemoryStats getMemoryStats () const;
+
+    private:
+    HerixLib::Herix base;
+    std::filesystem::path filename;
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range;
+    HerixLib::ChunkSize max_chunk_memory = 0;
+    HerixLib::ChunkSize max_chunk_size = 0;
+
+    PieceTable table;
+    // The inserted bytes. [0, added_spilled) are in added_spill, and the rest are in added.
+    std::vector<HerixLib::Byte> added;
+    size_t added_spilled = 0;
+    SpillFile added_spill;
+    // Applied records which change the layout. While there are none, source positions are file positions.
+    size_t layout_records = 0;
+
+    std::vector<EditRecord> records;
+    // records[0, applied) are what's currently shown, the rest can be redone
+    size_t applied = 0;
+    // Spans of the applied overwrites, so reading only goes through the ones it overlaps
+    RecordIndex record_index;
+    // Value of applied when last saved, nullopt if that state was dropped by editing after undoing past it
+    std::optional<size_t> saved_applied = 0;
+    uint64_t version = 0;
+    // If the newest record is one that edit()/insert() can still add to
+    bool session_open = false;
+
+    size_t memory_budget = 0;
+    // Bytes of record data in memory/spilled, including records that can be redone
+    size_t resident_record_bytes = 0;
+    size_t spilled_record_bytes = 0;
+    // Records before this have already been looked at for spilling
+    size_t spill_scan = 0;
+    SpillFile record_spill;
+
+    UndoJournal journal;
+    // records[0, journaled_records) are in the journal
+    size_t journaled_records = 0;
+
+    // (Re)opens the file through Herix, with no edits
+    void reopen ();
+    // The newest record, if edit()/insert() can still add to it
+    EditRecord* getSessionRecord ();
+    void push (EditRecord record);
+    // Adds/removes the applied overwrite records[index] to/from record_index, with the span it has right now
+    void indexRecord (size_t index, bool adding);
+    // Pushes an overwrite of [pos, pos + length) with the source of prototype, split into a record per piece it covers.
+    void pushRange (HerixLib::FilePosition pos, size_t length, const EditRecord& prototype);
+    // Source position of the byte at pos, and how many bytes from it on are in the same piece
+    std::pair<HerixLib::FilePosition, size_t> toSource (HerixLib::FilePosition pos) const;
+    void applyLayout (const EditRecord& record, bool undoing);
+    void writeJournal (const std::filesystem::path& journal_path,
+        const std::vector<std::pair<HerixLib::FilePosition, size_t>>& extents) const;
+    SaveStats saveLayout ();
+    size_t getAddedLength () const;
+    void readAdded (uint64_t offset, HerixLib::Byte* out, size_t size) const;
+    // Spills the oldest data until the resident bytes are down to half of the budget, if they went over it.
+    // Never spills what the current edit session can still change.
+    void enforceMemoryBudget ();
+    // Size and a hash of the start, middle and end of the file as Herix reads it
+    std::string getFingerprint ();
+    // Writes records[journaled_records, end) to the journal, which must not change after. Stops journaling if it fails.
+    void journalRecords (size_t end);
+    // The record's data from offset on, from wherever it is. scratch is used if it has to be read.
+    const HerixLib::Byte* getRecordData (const EditRecord& record, size_t offset, size_t size, std::vector<HerixLib::Byte>& scratch) const;
+    // [start, length) of every byte changed by the applied overwrites, sorted and with touching ranges joined.
+    // These are in source space, so are only file positions while there are no layout changes.
+    std::vector<std::pair<HerixLib::FilePosition, size_t>> getDirtyExtents () const;
+    // Applies the overwrites over data, which holds [pos, pos + size) of source space.
+    void applyRecords (HerixLib::FilePosition pos, HerixLib::Byte* data, size_t size) const;
+};
+
+#endif
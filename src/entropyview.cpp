@@ -0,0 +1,56 @@
+#include "./entropyview.hpp"
+
+namespace {
+    // Colored by what the data likely is, in bits per byte:
+    // < 1 padding/sparse, < 5 text/code, < 7 mixed data, < 7.5 compressed-ish, and above that compressed/encrypted.
+    MColors entropyColor (uint8_t entropy) {
+        if (entropy < 32) {
+            return MColors::BLACK_BLUE;
+        } else if (entropy < 160) {
+            return MColors::BLACK_GREEN;
+        } else if (entropy < 224) {
+            return MColors::BLACK_YELLOW;
+        } else if (entropy < 240) {
+            return MColors::BLACK_MAGENTA;
+        } else {
+            return MColors::BLACK_RED;
+        }
+    }
+}
+
+void renderEntropyView (SubView& sub_view, ViewWindow& view, const FileSummary& summary, HerixLib::FilePosition view_start, HerixLib::FilePosition view_end) {
+    const size_t height = static_cast<size_t>(std::max(sub_view.getHeight(), 0));
+    const size_t width = static_cast<size_t>(std::max(sub_view.getWidth(), 0));
+    const size_t file_end = summary.getFileEnd();
+    if (height == 0 || width == 0 || file_end == 0) {
+        return;
+    }
+
+    for (size_t row = 0; row < height; row++) {
+        // Bytes this row covers. Multiplying first keeps small files spread over the whole column.
+        HerixLib::FilePosition row_start = (row * file_end) / height;
+        HerixLib::FilePosition row_end = std::max(((row + 1) * file_end) / height, row_start + 1);
+
+        BlockSummary block = summary.summarizeRange(row_start, row_end);
+
+        bool in_view = row_start < view_end && view_start < row_end;
+        std::string text(width, ' ');
+        if (in_view) {
+            text[0] = '>';
+        }
+
+        sub_view.move(0, static_cast<int>(row));
+        if (!block.ready) {
+            // Not computed yet
+            if (!in_view) {
+                text[0] = '.';
+            }
+            sub_view.print(text);
+        } else {
+            MColors color = entropyColor(block.entropy);
+            view.enableColor(color);
+            sub_view.print(text);
+            view.disableColor(color);
+        }
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef FILE_SEEN_ENTROPYVIEW
+#define FILE_SEEN_ENTROPYVIEW
+
+#include "./subview.hpp"
+#include "./filesummary.hpp"
+
+// Draws the entropy of the whole file as a column, each row being the average of the blocks it covers.
+// Rows which overlap [view_start, view_end) (what is currently shown in the hex view) are marked.
+void renderEntropyView (SubView& sub_view, ViewWindow& view, const FileSummary& summary, HerixLib::FilePosition view_start, HerixLib::FilePosition view_end);
+
+#endif
@@ -0,0 +1,191 @@
+#include "./eventloop.hpp"
+
+#include <cerrno>
+#include <string>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+namespace {
+    std::runtime_error makeError (const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    sigset_t getHandledSignals () {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGWINCH);
+        return signals;
+    }
+
+    // Reads out a counter/signal so that the descriptor stops being readable
+    void drain (int fd, void* buffer, size_t size) {
+        while (::read(fd, buffer, size) < 0 && errno == EINTR) {}
+    }
+}
+
+EventLoop::EventLoop () {
+    event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (event_fd < 0) {
+        throw makeError("Failed creating eventfd");
+    }
+
+    // CLOCK_MONOTONIC is what std::chrono::steady_clock uses, so deadlines can be given to it directly
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_fd < 0) {
+        close(event_fd);
+        throw makeError("Failed creating timerfd");
+    }
+
+    sigset_t signals = getHandledSignals();
+    signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (signal_fd < 0) {
+        close(event_fd);
+        close(timer_fd);
+        throw makeError("Failed creating signalfd");
+    }
+}
+
+EventLoop::~EventLoop () {
+    close(event_fd);
+    close(timer_fd);
+    close(signal_fd);
+}
+
+void EventLoop::blockSignals () {
+    sigset_t signals = getHandledSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void EventLoop::post (std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        jobs.push_back(std::move(job));
+    }
+    uint64_t one = 1;
+    while (::write(event_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+}
+
+EventLoop::TimerID EventLoop::addTimer (std::chrono::milliseconds delay, std::optional<std::chrono::milliseconds> interval, std::function<void()> callback) {
+    TimerID id = next_timer_id++;
+    timers[id] = Timer{Clock::now() + delay, interval, std::move(callback)};
+    armTimer();
+    return id;
+}
+
+bool EventLoop::cancelTimer (TimerID id) {
+    if (timers.erase(id) == 0) {
+        return false;
+    }
+    armTimer();
+    return true;
+}
+
+EventLoop::WaitResult EventLoop::wait (int timeout_ms) {
+    WaitResult result;
+
+    pollfd fds[4] = {
+        {STDIN_FILENO, POLLIN, 0},
+        {event_fd, POLLIN, 0},
+        {timer_fd, POLLIN, 0},
+        {signal_fd, POLLIN, 0},
+    };
+    int ready = poll(fds, 4, timeout_ms);
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return result;
+        }
+        throw makeError("Failed waiting for events");
+    }
+
+    result.input = (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+    if ((fds[3].revents & POLLIN) != 0) {
+        signalfd_siginfo info;
+        drain(signal_fd, &info, sizeof(info));
+        result.resized = true;
+    }
+    return result;
+}
+
+bool EventLoop::dispatch () {
+    bool ran = runJobs();
+    return runTimers() || ran;
+}
+
+void EventLoop::armTimer () {
+    itimerspec spec{};
+    if (!timers.empty()) {
+        Clock::time_point earliest = Clock::time_point::max();
+        for (const auto& [id, timer] : timers) {
+            earliest = std::min(earliest, timer.deadline);
+        }
+
+        auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(earliest.time_since_epoch()).count();
+        spec.it_value.tv_sec = static_cast<time_t>(since_epoch / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(since_epoch % 1000000000);
+        // An all zero time would disarm it
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+bool EventLoop::runJobs () {
+    uint64_t count = 0;
+    drain(event_fd, &count, sizeof(count));
+
+    std::vector<std::function<void()>> taken;
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        taken.swap(jobs);
+    }
+    for (std::function<void()>& job : taken) {
+        job();
+    }
+    return !taken.empty();
+}
+
+bool EventLoop::runTimers () {
+    uint64_t expirations = 0;
+    drain(timer_fd, &expirations, sizeof(expirations));
+
+    // Collected first, since callbacks can add and cancel timers
+    Clock::time_point now = Clock::now();
+    std::vector<TimerID> due;
+    for (const auto& [id, timer] : timers) {
+        if (timer.deadline <= now) {
+            due.push_back(id);
+        }
+    }
+
+    for (TimerID id : due) {
+        auto iter = timers.find(id);
+        if (iter == timers.end()) {
+            // Cancelled by an earlier callback
+            continue;
+        }
+
+        std::function<void()> callback;
+        if (iter->second.interval.has_value()) {
+            // Scheduled from now rather than the old deadline, so a slow callback doesn't make it run back to back
+            iter->second.deadline = now + iter->second.interval.value();
+            callback = iter->second.callback;
+        } else {
+            callback = std::move(iter->second.callback);
+            timers.erase(iter);
+        }
+        callback();
+    }
+
+    armTimer();
+    return !due.empty();
+}
@@ -0,0 +1,75 @@
+#ifndef FILE_SEEN_EVENTLOOP
+#define FILE_SEEN_EVENTLOOP
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+// Waits on everything the interface reacts to with a single poll(): keys on stdin, jobs posted by worker threads
+// (through an eventfd), timers (through a timerfd), and terminal resizes (SIGWINCH, through a signalfd).
+// Nothing is woken up periodically, so while there's nothing to do no CPU is used at all.
+// Throws std::runtime_error if the descriptors can't be created.
+class EventLoop {
+    public:
+    using TimerID = uint64_t;
+
+    struct WaitResult {
+        // There's something to read on stdin
+        bool input = false;
+        bool resized = false;
+    };
+
+    EventLoop ();
+    EventLoop (const EventLoop&) = delete;
+    EventLoop& operator= (const EventLoop&) = delete;
+    ~EventLoop ();
+
+    // Blocks SIGWINCH so it is only seen through the signalfd. Has to be called before any threads are started,
+    // since they inherit the mask, and otherwise the signal might be delivered to one of them.
+    static void blockSignals ();
+
+    // Queues a job to be ran on the thread calling dispatch(), waking it up. Safe to call from any thread.
+    void post (std::function<void()> job);
+
+    // Calls the callback after delay, and then every interval if there is one.
+    TimerID addTimer (std::chrono::milliseconds delay, std::optional<std::chrono::milliseconds> interval, std::function<void()> callback);
+    // Returns false if there was no such timer (such as a timeout which already ran)
+    bool cancelTimer (TimerID id);
+
+    // Waits until there's input, a resize, a posted job or a due timer, or until timeout_ms has passed (-1 waits
+    // for as long as it takes).
+    WaitResult wait (int timeout_ms);
+    // Runs the posted jobs and the timers which are due. Returns true if anything ran.
+    bool dispatch ();
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Clock::time_point deadline;
+        std::optional<std::chrono::milliseconds> interval;
+        std::function<void()> callback;
+    };
+
+    int event_fd = -1;
+    int timer_fd = -1;
+    int signal_fd = -1;
+
+    std::mutex jobs_mutex;
+    std::vector<std::function<void()>> jobs;
+
+    // There's rarely more than a couple, so finding the earliest is just a scan
+    std::map<TimerID, Timer> timers;
+    TimerID next_timer_id = 1;
+
+    // Sets the timerfd to go off at the earliest deadline, or disarms it if there are no timers
+    void armTimer ();
+    bool runJobs ();
+    bool runTimers ();
+};
+
+#endif
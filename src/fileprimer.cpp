@@ -0,0 +1,55 @@
+#include "./fileprimer.hpp"
+
+#include <cerrno>
+#include <utility>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+FilePrimer::FilePrimer (std::filesystem::path t_filename, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range) :
+    filename(std::move(t_filename)), file_range(t_file_range) {
+    worker = std::thread(&FilePrimer::runWorker, this);
+}
+
+FilePrimer::~FilePrimer () {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+std::vector<HerixLib::Byte> FilePrimer::takeStart () {
+    if (worker.joinable()) {
+        worker.join();
+    }
+    return std::move(start);
+}
+
+void FilePrimer::runWorker () {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    size_t length = PRIME_SIZE;
+    if (file_range.second.has_value()) {
+        length = std::min(length, file_range.second.value() - std::min(file_range.first, file_range.second.value()));
+    }
+
+    // The kernel reads this in on its own, in the background
+    posix_fadvise(fd, static_cast<off_t>(file_range.first), static_cast<off_t>(std::max(length, READAHEAD_SIZE)), POSIX_FADV_WILLNEED);
+
+    start.resize(length);
+    size_t got = 0;
+    while (got < length) {
+        ssize_t amount = ::pread(fd, start.data() + got, length - got, static_cast<off_t>(file_range.first + got));
+        if (amount < 0 && errno == EINTR) {
+            continue;
+        } else if (amount <= 0) {
+            break;
+        }
+        got += static_cast<size_t>(amount);
+    }
+    start.resize(got);
+    ::close(fd);
+}
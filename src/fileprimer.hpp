@@ -0,0 +1,41 @@
+#ifndef FILE_SEEN_FILEPRIMER
+#define FILE_SEEN_FILEPRIMER
+
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <filesystem>
+#include "./Herix/src/herix.hpp"
+
+// Reads the start of the file on a worker thread while lua and the config are being set up, since the file can't
+// be opened through Herix until the config says how. The bytes are kept for checking format magic, and reading
+// them (plus asking the kernel to read ahead) means the first screen comes from the page cache instead of the disk.
+class FilePrimer {
+    public:
+    // Enough for the first screen on any reasonable terminal, and any magic
+    static constexpr size_t PRIME_SIZE = 1024 * 64;
+    // Past that, only a hint to read it in
+    static constexpr size_t READAHEAD_SIZE = 1024 * 1024;
+
+    // Starts the worker right away. Nothing about the file is checked, errors just leave nothing primed.
+    FilePrimer (std::filesystem::path t_filename, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range);
+    FilePrimer (const FilePrimer&) = delete;
+    FilePrimer& operator= (const FilePrimer&) = delete;
+    ~FilePrimer ();
+
+    // Waits for the worker, and gives the bytes at the start of the file range as they were on disk. Fewer if the
+    // file is shorter, and empty if it couldn't be read. Can only be taken once.
+    std::vector<HerixLib::Byte> takeStart ();
+
+    private:
+    std::filesystem::path filename;
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range;
+    // Written only by the worker, until it's joined
+    std::vector<HerixLib::Byte> start;
+    std::thread worker;
+
+    void runWorker ();
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "./filesummary.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+
+#include "./histogram.hpp"
+
+FileSummary::FileSummary (std::filesystem::path t_filename, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range, size_t t_file_end,
+    std::function<void()> t_on_finished) :
+    filename(t_filename), file_range(t_file_range), file_end(t_file_end), on_finished(std::move(t_on_finished)) {
+    // Smallest power of two which keeps us under MAX_BLOCKS
+    block_size = MIN_BLOCK_SIZE;
+    while (block_size * MAX_BLOCKS < file_end) {
+        block_size *= 2;
+    }
+
+    size_t block_count = (file_end + block_size - 1) / block_size;
+    levels.emplace_back(block_count);
+    while (levels.back().size() > 1) {
+        levels.emplace_back((levels.back().size() + 1) / 2);
+    }
+    states.resize(block_count, BlockState::Pending);
+    worker_blocks.resize(block_count);
+
+    // The worker gets its own copy of the length, since file_end changes on resizing
+    worker = std::thread(&FileSummary::runWorker, this, file_end);
+}
+
+FileSummary::~FileSummary () {
+    worker_stop = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+size_t FileSummary::getBlockSize () const {
+    return block_size;
+}
+size_t FileSummary::getBlockCount () const {
+    return levels[0].size();
+}
+size_t FileSummary::getFileEnd () const {
+    return file_end;
+}
+const BlockSummary& FileSummary::getBlock (size_t index) const {
+    return levels[0].at(index);
+}
+
+namespace {
+    // Average of the entries which are ready. Not ready if none of them are.
+    template<typename It>
+    BlockSummary averageSummaries (It begin, It end) {
+        size_t entropy = 0;
+        size_t zeroes = 0;
+        size_t printable = 0;
+        size_t count = 0;
+        for (It it = begin; it != end; ++it) {
+            if (it->ready) {
+                entropy += it->entropy;
+                zeroes += it->zeroes;
+                printable += it->printable;
+                count++;
+            }
+        }
+
+        BlockSummary ret;
+        if (count != 0) {
+            ret.entropy = static_cast<uint8_t>(entropy / count);
+            ret.zeroes = static_cast<uint8_t>(zeroes / count);
+            ret.printable = static_cast<uint8_t>(printable / count);
+            ret.ready = true;
+        }
+        return ret;
+    }
+}
+
+BlockSummary FileSummary::summarizeRange (HerixLib::FilePosition start, HerixLib::FilePosition end) const {
+    end = std::min(end, file_end);
+    if (start >= end) {
+        return BlockSummary();
+    }
+
+    // Coarsest level whose entries still fit in the range, so that at most three entries overlap it.
+    size_t level = 0;
+    while (level + 1 < levels.size() && (block_size << (level + 1)) <= end - start) {
+        level++;
+    }
+
+    size_t entry_size = block_size << level;
+    const std::vector<BlockSummary>& entries = levels[level];
+    size_t first = start / entry_size;
+    size_t last = std::min((end - 1) / entry_size + 1, entries.size());
+    return averageSummaries(entries.begin() + static_cast<long>(first), entries.begin() + static_cast<long>(last));
+}
+
+void FileSummary::markDirty (HerixLib::FilePosition pos, size_t length) {
+    if (length == 0 || pos >= file_end) {
+        return;
+    }
+
+    size_t first = pos / block_size;
+    size_t last = std::min(pos + length - 1, file_end - 1) / block_size;
+    for (size_t i = first; i <= last; i++) {
+        if (states[i] != BlockState::Dirty) {
+            states[i] = BlockState::Dirty;
+            dirty.push_back(i);
+        }
+    }
+}
+
+bool FileSummary::update (EditLayer& hex, size_t max_dirty) {
+    bool changed = false;
+
+    size_t limit = getWorkerLimit();
+    for (; applied < limit; applied++) {
+        if (states[applied] == BlockState::Pending) {
+            setBlock(applied, worker_blocks[applied]);
+            states[applied] = BlockState::Ready;
+            changed = true;
+        }
+    }
+
+    for (size_t n = 0; n < max_dirty && !dirty.empty(); n++) {
+        size_t index = dirty.back();
+        dirty.pop_back();
+
+        HerixLib::FilePosition start = index * block_size;
+        std::vector<HerixLib::Byte> data = hex.readMultipleCutoff(start, std::min(block_size, file_end - start));
+        setBlock(index, summarize(data.data(), data.size()));
+        // It keeps being owned by the main thread, since the file on disk is still different
+        states[index] = BlockState::Ready;
+        changed = true;
+    }
+
+    return changed;
+}
+
+bool FileSummary::hasPendingWork () const {
+    return applied < std::min(worker_blocks.size(), levels[0].size()) || !dirty.empty();
+}
+
+void FileSummary::resize (size_t new_file_end, HerixLib::FilePosition changed_from) {
+    file_end = new_file_end;
+    size_t block_count = (file_end + block_size - 1) / block_size;
+
+    states.resize(block_count, BlockState::Pending);
+    levels[0].resize(block_count);
+    dirty.erase(std::remove_if(dirty.begin(), dirty.end(), [block_count] (size_t index) {
+        return index >= block_count;
+    }), dirty.end());
+    // The old summaries stay shown until they're recomputed, as they're usually close
+    for (size_t i = std::min(changed_from / block_size, block_count); i < block_count; i++) {
+        if (states[i] != BlockState::Dirty) {
+            states[i] = BlockState::Dirty;
+            dirty.push_back(i);
+        }
+    }
+
+    rebuildLevels();
+}
+
+size_t FileSummary::getWorkerLimit () const {
+    size_t progress = worker_progress.load(std::memory_order_acquire);
+    return std::min(progress, states.size());
+}
+
+void FileSummary::runWorker (size_t worker_file_end) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        // Nothing can be done, so just mark everything as finished with empty values.
+        worker_progress.store(worker_blocks.size(), std::memory_order_release);
+        if (on_finished) {
+            on_finished();
+        }
+        return;
+    }
+
+    file.seekg(static_cast<std::streamoff>(file_range.first));
+
+    std::vector<HerixLib::Byte> buffer(block_size);
+    for (size_t index = 0; index < worker_blocks.size() && !worker_stop; index++) {
+        size_t length = std::min(block_size, worker_file_end - index * block_size);
+        file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(length));
+        size_t got = static_cast<size_t>(std::max<std::streamsize>(file.gcount(), 0));
+
+        worker_blocks[index] = summarize(buffer.data(), got);
+        worker_progress.store(index + 1, std::memory_order_release);
+    }
+    if (on_finished) {
+        on_finished();
+    }
+}
+
+void FileSummary::setBlock (size_t index, const BlockSummary& summary) {
+    levels[0][index] = summary;
+    for (size_t level = 1; level < levels.size(); level++) {
+        size_t child = index - (index % 2);
+        size_t child_end = std::min(child + 2, levels[level - 1].size());
+        index /= 2;
+        levels[level][index] = averageSummaries(levels[level - 1].begin() + static_cast<long>(child),
+            levels[level - 1].begin() + static_cast<long>(child_end));
+    }
+}
+
+void FileSummary::rebuildLevels () {
+    levels.resize(1);
+    while (levels.back().size() > 1) {
+        const std::vector<BlockSummary>& below = levels.back();
+        std::vector<BlockSummary> level((below.size() + 1) / 2);
+        for (size_t i = 0; i < level.size(); i++) {
+            size_t child_end = std::min(i * 2 + 2, below.size());
+            level[i] = averageSummaries(below.begin() + static_cast<long>(i * 2), below.begin() + static_cast<long>(child_end));
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+BlockSummary FileSummary::summarize (const HerixLib::Byte* data, size_t size) {
+    ByteHistogram hist{};
+    countBytes(data, size, hist);
+
+    BlockSummary ret;
+    ret.ready = true;
+    if (size == 0) {
+        return ret;
+    }
+
+    uint64_t printable = 0;
+    for (size_t v = 32; v <= 126; v++) {
+        printable += hist[v];
+    }
+
+    ret.entropy = static_cast<uint8_t>(std::lround(shannonEntropy(hist, size) * 255.0 / 8.0));
+    ret.zeroes = static_cast<uint8_t>((hist[0] * 255) / size);
+    ret.printable = static_cast<uint8_t>((printable * 255) / size);
+    return ret;
+}
@@ -0,0 +1,100 @@
+#ifndef FILE_SEEN_FILESUMMARY
+#define FILE_SEEN_FILESUMMARY
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include "./editlayer.hpp"
+
+struct BlockSummary {
+    // Shannon entropy, scaled from [0, 8] bits to [0, 255]
+    uint8_t entropy = 0;
+    // Ratio of zero bytes, and of printable ascii bytes, scaled to [0, 255]
+    uint8_t zeroes = 0;
+    uint8_t printable = 0;
+    bool ready = false;
+};
+
+// Per-block statistics over the whole file, small enough to keep around for any file size.
+// The initial pass is done by a worker thread which reads the file on disk itself, since Herix isn't thread safe.
+// Blocks touched by unsaved edits are recomputed on the main thread through the EditLayer, in update().
+// On top of the blocks is a pyramid where each level averages pairs from the one below, so any range can be
+// summarized by looking at a couple of entries no matter how large it is.
+class FileSummary {
+    public:
+    // Upper bound on the amount of blocks, the block size grows with the file to stay under it.
+    static constexpr size_t MAX_BLOCKS = 16384;
+    static constexpr size_t MIN_BLOCK_SIZE = 4096;
+
+    // on_finished is called from the worker thread once it is done, so it has to be thread safe.
+    FileSummary (std::filesystem::path t_filename, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range, size_t t_file_end,
+        std::function<void()> t_on_finished = nullptr);
+    FileSummary (const FileSummary&) = delete;
+    FileSummary& operator= (const FileSummary&) = delete;
+    ~FileSummary ();
+
+    size_t getBlockSize () const;
+    size_t getBlockCount () const;
+    size_t getFileEnd () const;
+    const BlockSummary& getBlock (size_t index) const;
+    // Averages the summaries of the blocks that [start, end) covers, in constant time.
+    // Since it uses the pyramid, the edges are rounded out to the entries of the level it picks.
+    BlockSummary summarizeRange (HerixLib::FilePosition start, HerixLib::FilePosition end) const;
+
+    // Call when bytes in the range have been changed, so the blocks they are in get recomputed.
+    void markDirty (HerixLib::FilePosition pos, size_t length);
+    // Call when bytes were inserted/removed at changed_from. The blocks before it are kept, and every one after it
+    // is recomputed, since its bytes moved. The block size stays the same.
+    void resize (size_t new_file_end, HerixLib::FilePosition changed_from);
+
+    // Takes in what the worker has finished, and recomputes up to max_dirty blocks that were edited.
+    // Returns true if any block changed.
+    bool update (EditLayer& hex, size_t max_dirty);
+
+    // If there is still work left, either in the worker or from edits.
+    bool hasPendingWork () const;
+
+    private:
+    enum class BlockState : uint8_t {
+        // Waiting on the worker
+        Pending,
+        Ready,
+        // Edited, the worker's result (from the file on disk) is out of date.
+        Dirty,
+    };
+
+    std::filesystem::path filename;
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range;
+    size_t file_end;
+    size_t block_size;
+
+    // levels[0] are the blocks themselves, each level after has half as many entries.
+    std::vector<std::vector<BlockSummary>> levels;
+    std::vector<BlockState> states;
+    std::vector<size_t> dirty;
+
+    // Written only by the worker. Entries before worker_progress are final.
+    // Sized for the file as it was opened, which is all the worker reads, even if the file is resized after.
+    std::vector<BlockSummary> worker_blocks;
+    std::atomic<size_t> worker_progress = 0;
+    std::atomic<bool> worker_stop = false;
+    std::function<void()> on_finished;
+    // How far into worker_blocks has been taken in by update()
+    size_t applied = 0;
+    std::thread worker;
+
+    void runWorker (size_t worker_file_end);
+    // Sets the block and updates the levels above it
+    void setBlock (size_t index, const BlockSummary& summary);
+    // Makes the levels fit the amount of blocks, and recomputes all of them
+    void rebuildLevels ();
+    // How much of worker_blocks update() can take in
+    size_t getWorkerLimit () const;
+    static BlockSummary summarize (const HerixLib::Byte* data, size_t size);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "./frametimes.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <utility>
+#include <algorithm>
+
+namespace {
+    // Nearest-rank, on samples which are already sorted
+    double percentile (const std::vector<float>& sorted, double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return static_cast<double>(sorted.at(std::clamp<size_t>(rank, 1, sorted.size()) - 1));
+    }
+}
+
+FrameTimes::FrameTimes () {
+    for (const char* name : {"frame", "key handlers", "functional", "read", "write listeners", "bar", "flush"}) {
+        addStage(name);
+    }
+}
+
+FrameTimes::StageID FrameTimes::addStage (std::string name) {
+    stages.emplace_back();
+    stages.back().name = std::move(name);
+    return stages.size() - 1;
+}
+
+void FrameTimes::beginFrame () {
+    if (depth++ == 0) {
+        frame_start = std::chrono::steady_clock::now();
+    }
+}
+
+void FrameTimes::endFrame () {
+    if (depth == 0 || --depth != 0) {
+        return;
+    }
+    // Frames where nothing was done, such as an idle wake up with no progress to draw, would only drag it down
+    if (touched.empty()) {
+        return;
+    }
+
+    for (StageID id : touched) {
+        Stage& stage = stages[id];
+        push(stage, stage.pending);
+        stage.pending = std::chrono::steady_clock::duration(0);
+        stage.touched = false;
+    }
+    touched.clear();
+    push(stages[FRAME], std::chrono::steady_clock::now() - frame_start);
+}
+
+void FrameTimes::add (StageID id, std::chrono::steady_clock::duration duration) {
+    Stage& stage = stages.at(id);
+    if (depth == 0) {
+        push(stage, duration);
+        return;
+    }
+    stage.pending += duration;
+    if (!stage.touched) {
+        stage.touched = true;
+        touched.push_back(id);
+    }
+}
+
+std::vector<FrameTimes::Summary> FrameTimes::summarize () const {
+    std::vector<Summary> summaries;
+    std::vector<float> sorted;
+    for (const Stage& stage : stages) {
+        if (stage.count == 0) {
+            continue;
+        }
+        sorted.assign(stage.samples.begin(), stage.samples.begin() + static_cast<long>(stage.count));
+        std::sort(sorted.begin(), sorted.end());
+        size_t last = (stage.next + CAPACITY - 1) % CAPACITY;
+        summaries.push_back(Summary{
+            stage.name, stage.count, static_cast<double>(stage.samples[last]),
+            percentile(sorted, 0.50), percentile(sorted, 0.95), percentile(sorted, 0.99)
+        });
+    }
+    return summaries;
+}
+
+std::vector<std::string> FrameTimes::getReport () const {
+    std::vector<std::string> lines;
+    lines.push_back("Frame times (ms), over the last " + std::to_string(CAPACITY) + " samples of each:");
+    for (const Summary& summary : summarize()) {
+        char buffer[160];
+        std::snprintf(buffer, sizeof(buffer), "  p50 %8.3f  p95 %8.3f  p99 %8.3f  (%zu)  ",
+            summary.p50_ms, summary.p95_ms, summary.p99_ms, summary.samples);
+        lines.push_back(buffer + summary.name);
+    }
+    return lines;
+}
+
+void FrameTimes::push (Stage& stage, std::chrono::steady_clock::duration duration) {
+    stage.samples[stage.next] = std::chrono::duration<float, std::milli>(duration).count();
+    stage.next = (stage.next + 1) % CAPACITY;
+    stage.count = std::min(stage.count + 1, CAPACITY);
+}
@@ -0,0 +1,88 @@
+#ifndef FILE_SEEN_FRAMETIMES
+#define FILE_SEEN_FRAMETIMES
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// How long each stage of drawing a frame took, over the last CAPACITY times it ran, for finding out why frames are
+// slow. A stage that runs more than once in a frame (such as reading, or a plugin's view) is summed up into one
+// sample for the frame. Stages can be inside of each other, so they don't add up to the frame.
+class FrameTimes {
+    public:
+    using StageID = size_t;
+    static constexpr size_t CAPACITY = 512;
+
+    // Always there, in this order. Plugins' views are added after.
+    static constexpr StageID FRAME = 0;
+    static constexpr StageID KEY_HANDLERS = 1;
+    static constexpr StageID FUNCTIONAL = 2;
+    static constexpr StageID READ = 3;
+    static constexpr StageID WRITE_LISTENERS = 4;
+    static constexpr StageID BAR = 5;
+    static constexpr StageID FLUSH = 6;
+
+    // Records the time from its creation to its destruction under the stage
+    class Scope {
+        public:
+        Scope (FrameTimes& t_times, StageID t_stage) : times(t_times), stage(t_stage), start(std::chrono::steady_clock::now()) {}
+        Scope (const Scope&) = delete;
+        Scope& operator= (const Scope&) = delete;
+        ~Scope () {
+            times.add(stage, std::chrono::steady_clock::now() - start);
+        }
+
+        private:
+        FrameTimes& times;
+        StageID stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    struct Summary {
+        std::string name;
+        size_t samples;
+        double last_ms;
+        double p50_ms;
+        double p95_ms;
+        double p99_ms;
+    };
+
+    FrameTimes ();
+
+    StageID addStage (std::string name);
+
+    // Frames can be begun again inside of one (a resize handles a key), only the outermost counts
+    void beginFrame ();
+    void endFrame ();
+    // Outside of a frame it's recorded as a sample right away
+    void add (StageID stage, std::chrono::steady_clock::duration duration);
+
+    // Stages which have run, in the order they were added
+    std::vector<Summary> summarize () const;
+    // A line for each stage, for the exit logs
+    std::vector<std::string> getReport () const;
+
+    private:
+    struct Stage {
+        std::string name;
+        // In milliseconds, next is where the next one goes once there are CAPACITY of them
+        std::array<float, CAPACITY> samples{};
+        size_t next = 0;
+        size_t count = 0;
+        // Summed up over the current frame
+        std::chrono::steady_clock::duration pending{0};
+        bool touched = false;
+    };
+
+    std::vector<Stage> stages;
+    // Which stages have something pending, so ending a frame doesn't go through all of them
+    std::vector<StageID> touched;
+    unsigned int depth = 0;
+    std::chrono::steady_clock::time_point frame_start;
+
+    static void push (Stage& stage, std::chrono::steady_clock::duration duration);
+};
+
+#endif
@@ -0,0 +1,712 @@
+#include "./hashing.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "./mutil.hpp"
+
+#if defined(__x86_64__)
+#define HERIXTUI_HASH_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+using HerixLib::Byte;
+
+namespace {
+    constexpr size_t HASH_READ_SIZE = 1024 * 1024;
+
+    uint32_t rotl32 (uint32_t v, int amount) {
+        return (v << amount) | (v >> (32 - amount));
+    }
+    uint32_t rotr32 (uint32_t v, int amount) {
+        return (v >> amount) | (v << (32 - amount));
+    }
+    uint64_t rotl64 (uint64_t v, int amount) {
+        return (v << amount) | (v >> (64 - amount));
+    }
+
+    uint32_t readBE32 (const Byte* data) {
+        return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+            (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+    }
+    uint32_t readLE32 (const Byte* data) {
+        return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+            (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+    uint64_t readLE64 (const Byte* data) {
+        return static_cast<uint64_t>(readLE32(data)) | (static_cast<uint64_t>(readLE32(data + 4)) << 32);
+    }
+
+    std::string toHex (uint64_t value, size_t digits) {
+        static const char HEX[] = "0123456789abcdef";
+        std::string res(digits, '0');
+        for (size_t i = digits; i > 0; i--) {
+            res[i - 1] = HEX[value & 0xF];
+            value >>= 4;
+        }
+        return res;
+    }
+
+    // == CPU features ==
+
+    struct CpuFeatures {
+        bool sse42 = false;
+        bool pclmul = false;
+        bool sha = false;
+    };
+
+    bool acceleration_enabled = true;
+
+    const CpuFeatures& getCpuFeatures () {
+        static const CpuFeatures features = [] () {
+            CpuFeatures ret;
+#ifdef HERIXTUI_HASH_X86
+            unsigned int a, b, c, d;
+            bool sse41 = false;
+            bool ssse3 = false;
+            if (__get_cpuid(1, &a, &b, &c, &d)) {
+                ret.sse42 = (c & bit_SSE4_2) != 0;
+                sse41 = (c & bit_SSE4_1) != 0;
+                ssse3 = (c & bit_SSSE3) != 0;
+                ret.pclmul = (c & bit_PCLMUL) != 0 && sse41;
+            }
+            if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+                ret.sha = (b & bit_SHA) != 0 && sse41 && ssse3;
+            }
+#endif
+            return ret;
+        }();
+        return features;
+    }
+
+    bool useSSE42 () {
+        return acceleration_enabled && getCpuFeatures().sse42;
+    }
+    bool usePCLMUL () {
+        return acceleration_enabled && getCpuFeatures().pclmul;
+    }
+    bool useSHA () {
+        return acceleration_enabled && getCpuFeatures().sha;
+    }
+
+    // == CRC32 / CRC32C ==
+
+    // Slicing-by-8 tables for a reflected polynomial. tables[k][i] is the crc of byte i followed by k zero bytes.
+    using CRCTables = std::array<std::array<uint32_t, 256>, 8>;
+
+    CRCTables makeCRCTables (uint32_t polynomial) {
+        CRCTables tables;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
+            }
+            tables[0][i] = crc;
+        }
+        for (size_t k = 1; k < 8; k++) {
+            for (size_t i = 0; i < 256; i++) {
+                uint32_t prev = tables[k - 1][i];
+                tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    const CRCTables& getCRC32Tables () {
+        static const CRCTables tables = makeCRCTables(0xEDB88320);
+        return tables;
+    }
+    const CRCTables& getCRC32CTables () {
+        static const CRCTables tables = makeCRCTables(0x82F63B78);
+        return tables;
+    }
+
+    uint32_t crcPortable (const CRCTables& t, uint32_t crc, const Byte* data, size_t size) {
+        while (size >= 8) {
+            uint32_t one = readLE32(data) ^ crc;
+            uint32_t two = readLE32(data + 4);
+            crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+                t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+            data += 8;
+            size -= 8;
+        }
+        for (; size > 0; size--) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+        }
+        return crc;
+    }
+
+#ifdef HERIXTUI_HASH_X86
+    // The crc32 instruction only implements the Castagnoli polynomial.
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cSSE42 (uint32_t crc, const Byte* data, size_t size) {
+        uint64_t crc64 = crc;
+        while (size >= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+            data += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        for (; size > 0; size--) {
+            crc = _mm_crc32_u8(crc, *data++);
+        }
+        return crc;
+    }
+
+    __m128i load (const Byte* at) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+    }
+    // Multiplies both halves of value by the constants, which moves it forward by however far they're for,
+    // and adds it onto the data that's there.
+    __attribute__((target("pclmul")))
+    __m128i fold (__m128i value, __m128i constants, __m128i next) {
+        __m128i low = _mm_clmulepi64_si128(value, constants, 0x00);
+        __m128i high = _mm_clmulepi64_si128(value, constants, 0x11);
+        return _mm_xor_si128(_mm_xor_si128(high, low), next);
+    }
+
+    // Carry-less multiplication folding, from Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ".
+    // Four 128 bit lanes are folded forward 64 bytes at a time, then into one lane, and Barrett reduced to 32 bits.
+    // size has to be a multiple of 16 and at least 64.
+    __attribute__((target("pclmul,sse4.1")))
+    uint32_t crc32PCLMUL (uint32_t crc, const Byte* data, size_t size) {
+        const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+        const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+        const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124);
+        const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+        const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+        __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+        __m128i x2 = load(data + 16);
+        __m128i x3 = load(data + 32);
+        __m128i x4 = load(data + 48);
+        data += 64;
+        size -= 64;
+
+        while (size >= 64) {
+            x1 = fold(x1, k1k2, load(data));
+            x2 = fold(x2, k1k2, load(data + 16));
+            x3 = fold(x3, k1k2, load(data + 32));
+            x4 = fold(x4, k1k2, load(data + 48));
+            data += 64;
+            size -= 64;
+        }
+
+        x1 = fold(x1, k3k4, x2);
+        x1 = fold(x1, k3k4, x3);
+        x1 = fold(x1, k3k4, x4);
+        while (size >= 16) {
+            x1 = fold(x1, k3k4, load(data));
+            data += 16;
+            size -= 16;
+        }
+
+        // 128 bits down to 64
+        __m128i rest = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), rest);
+        rest = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, mask32);
+        x1 = _mm_clmulepi64_si128(x1, k5, 0x00);
+        x1 = _mm_xor_si128(x1, rest);
+
+        // Barrett reduction to 32 bits
+        rest = _mm_and_si128(x1, mask32);
+        rest = _mm_clmulepi64_si128(rest, poly, 0x10);
+        rest = _mm_and_si128(rest, mask32);
+        rest = _mm_clmulepi64_si128(rest, poly, 0x00);
+        x1 = _mm_xor_si128(x1, rest);
+        return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+    }
+#endif
+
+    uint32_t crc32Update (uint32_t crc, const Byte* data, size_t size) {
+#ifdef HERIXTUI_HASH_X86
+        if (size >= 64 && usePCLMUL()) {
+            size_t folded = size & ~size_t(15);
+            crc = crc32PCLMUL(crc, data, folded);
+            data += folded;
+            size -= folded;
+        }
+#endif
+        return crcPortable(getCRC32Tables(), crc, data, size);
+    }
+
+    uint32_t crc32cUpdate (uint32_t crc, const Byte* data, size_t size) {
+#ifdef HERIXTUI_HASH_X86
+        if (useSSE42()) {
+            return crc32cSSE42(crc, data, size);
+        }
+#endif
+        return crcPortable(getCRC32CTables(), crc, data, size);
+    }
+
+    // == SHA-1 ==
+
+    void sha1Portable (uint32_t* state, const Byte* data, size_t blocks) {
+        for (; blocks > 0; blocks--, data += 64) {
+            std::array<uint32_t, 80> w;
+            for (size_t i = 0; i < 16; i++) {
+                w[i] = readBE32(data + i * 4);
+            }
+            for (size_t i = 16; i < 80; i++) {
+                w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+            // One loop per round function, rather than picking it every round
+            auto rounds = [&] (size_t first, uint32_t k, auto function) {
+                for (size_t i = first; i < first + 20; i++) {
+                    uint32_t temp = rotl32(a, 5) + function(b, c, d) + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = rotl32(b, 30);
+                    b = a;
+                    a = temp;
+                }
+            };
+            rounds(0, 0x5A827999, [] (uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (~x & z); });
+            rounds(20, 0x6ED9EBA1, [] (uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; });
+            rounds(40, 0x8F1BBCDC, [] (uint32_t x, uint32_t y, uint32_t z) { return (x & y) | (x & z) | (y & z); });
+            rounds(60, 0xCA62C1D6, [] (uint32_t x, uint32_t y, uint32_t z) { return x ^ y ^ z; });
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+    }
+
+#ifdef HERIXTUI_HASH_X86
+    // Four rounds per sha1rnds4, with the message schedule done by sha1msg1/sha1msg2.
+    // msg[g % 4] holds the words for rounds [4g, 4g + 4), and is turned into the ones for group g + 4 as it goes.
+    __attribute__((target("sha,sse4.1,ssse3")))
+    void sha1SHANI (uint32_t* state, const Byte* data, size_t blocks) {
+        const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607, 0x08090a0b0c0d0e0f);
+
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+        __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+        for (; blocks > 0; blocks--, data += 64) {
+            const __m128i abcd_save = abcd;
+            const __m128i e0_save = e0;
+            __m128i e1;
+            __m128i msg[4];
+
+#define HERIXTUI_SHA1_GROUP(g, e_cur, e_next, function) \
+            if ((g) < 4) { \
+                msg[(g) % 4] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + (g) * 16)), byte_swap); \
+            } \
+            if ((g) == 0) { \
+                e_cur = _mm_add_epi32(e_cur, msg[0]); \
+            } else { \
+                e_cur = _mm_sha1nexte_epu32(e_cur, msg[(g) % 4]); \
+            } \
+            e_next = abcd; \
+            if ((g) >= 3 && (g) <= 18) { \
+                msg[((g) + 1) % 4] = _mm_sha1msg2_epu32(msg[((g) + 1) % 4], msg[(g) % 4]); \
+            } \
+            abcd = _mm_sha1rnds4_epu32(abcd, e_cur, function); \
+            if ((g) >= 1 && (g) <= 16) { \
+                msg[((g) + 3) % 4] = _mm_sha1msg1_epu32(msg[((g) + 3) % 4], msg[(g) % 4]); \
+            } \
+            if ((g) >= 2 && (g) <= 17) { \
+                msg[((g) + 2) % 4] = _mm_xor_si128(msg[((g) + 2) % 4], msg[(g) % 4]); \
+            }
+
+            HERIXTUI_SHA1_GROUP(0, e0, e1, 0)
+            HERIXTUI_SHA1_GROUP(1, e1, e0, 0)
+            HERIXTUI_SHA1_GROUP(2, e0, e1, 0)
+            HERIXTUI_SHA1_GROUP(3, e1, e0, 0)
+            HERIXTUI_SHA1_GROUP(4, e0, e1, 0)
+            HERIXTUI_SHA1_GROUP(5, e1, e0, 1)
+            HERIXTUI_SHA1_GROUP(6, e0, e1, 1)
+            HERIXTUI_SHA1_GROUP(7, e1, e0, 1)
+            HERIXTUI_SHA1_GROUP(8, e0, e1, 1)
+            HERIXTUI_SHA1_GROUP(9, e1, e0, 1)
+            HERIXTUI_SHA1_GROUP(10, e0, e1, 2)
+            HERIXTUI_SHA1_GROUP(11, e1, e0, 2)
+            HERIXTUI_SHA1_GROUP(12, e0, e1, 2)
+            HERIXTUI_SHA1_GROUP(13, e1, e0, 2)
+            HERIXTUI_SHA1_GROUP(14, e0, e1, 2)
+            HERIXTUI_SHA1_GROUP(15, e1, e0, 3)
+            HERIXTUI_SHA1_GROUP(16, e0, e1, 3)
+            HERIXTUI_SHA1_GROUP(17, e1, e0, 3)
+            HERIXTUI_SHA1_GROUP(18, e0, e1, 3)
+            HERIXTUI_SHA1_GROUP(19, e1, e0, 3)
+#undef HERIXTUI_SHA1_GROUP
+
+            e0 = _mm_sha1nexte_epu32(e0, e0_save);
+            abcd = _mm_add_epi32(abcd, abcd_save);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+        state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+    }
+#endif
+
+    void sha1Blocks (uint32_t* state, const Byte* data, size_t blocks) {
+#ifdef HERIXTUI_HASH_X86
+        if (useSHA()) {
+            return sha1SHANI(state, data, blocks);
+        }
+#endif
+        sha1Portable(state, data, blocks);
+    }
+
+    // == SHA-256 ==
+
+    alignas(16) const uint32_t SHA256_K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    void sha256Portable (uint32_t* state, const Byte* data, size_t blocks) {
+        for (; blocks > 0; blocks--, data += 64) {
+            std::array<uint32_t, 64> w;
+            for (size_t i = 0; i < 16; i++) {
+                w[i] = readBE32(data + i * 4);
+            }
+            for (size_t i = 16; i < 64; i++) {
+                uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (size_t i = 0; i < 64; i++) {
+                uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+                uint32_t choice = (e & f) ^ (~e & g);
+                uint32_t temp1 = h + s1 + choice + SHA256_K[i] + w[i];
+                uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+                uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+                uint32_t temp2 = s0 + majority;
+                h = g;
+                g = f;
+                f = e;
+                e = d + temp1;
+                d = c;
+                c = b;
+                b = a;
+                a = temp1 + temp2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+#ifdef HERIXTUI_HASH_X86
+    // Same layout as sha1SHANI: msg[g % 4] holds the words for rounds [4g, 4g + 4).
+    // The state is kept as the ABEF/CDGH register pair that sha256rnds2 wants.
+    __attribute__((target("sha,sse4.1,ssse3")))
+    void sha256SHANI (uint32_t* state, const Byte* data, size_t blocks) {
+        const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+        __m128i temp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+        state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+        for (; blocks > 0; blocks--, data += 64) {
+            const __m128i abef_save = state0;
+            const __m128i cdgh_save = state1;
+            __m128i msg[4];
+
+            for (size_t g = 0; g < 16; g++) {
+                if (g < 4) {
+                    msg[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + g * 16)), byte_swap);
+                }
+                __m128i words = _mm_add_epi32(msg[g % 4], _mm_load_si128(reinterpret_cast<const __m128i*>(SHA256_K + g * 4)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+                if (g >= 3 && g <= 14) {
+                    __m128i& next = msg[(g + 1) % 4];
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(msg[g % 4], msg[(g + 3) % 4], 4));
+                    next = _mm_sha256msg2_epu32(next, msg[g % 4]);
+                }
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(words, 0x0E));
+                if (g >= 1 && g <= 12) {
+                    msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], msg[g % 4]);
+                }
+            }
+
+            state0 = _mm_add_epi32(state0, abef_save);
+            state1 = _mm_add_epi32(state1, cdgh_save);
+        }
+
+        temp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(temp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, temp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+    }
+#endif
+
+    void sha256Blocks (uint32_t* state, const Byte* data, size_t blocks) {
+#ifdef HERIXTUI_HASH_X86
+        if (useSHA()) {
+            return sha256SHANI(state, data, blocks);
+        }
+#endif
+        sha256Portable(state, data, blocks);
+    }
+
+    // == xxHash64 ==
+
+    constexpr uint64_t XXH_PRIME1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t XXH_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t XXH_PRIME3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t XXH_PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t XXH_PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    uint64_t xxhRound (uint64_t accumulator, uint64_t input) {
+        accumulator += input * XXH_PRIME2;
+        accumulator = rotl64(accumulator, 31);
+        return accumulator * XXH_PRIME1;
+    }
+    uint64_t xxhMergeRound (uint64_t accumulator, uint64_t value) {
+        accumulator ^= xxhRound(0, value);
+        return accumulator * XXH_PRIME1 + XXH_PRIME4;
+    }
+
+    // Already vectorizes well enough as is, the four lanes are independent.
+    void xxhStripes (std::array<uint64_t, 4>& accumulators, const Byte* data, size_t stripes) {
+        for (; stripes > 0; stripes--, data += 32) {
+            accumulators[0] = xxhRound(accumulators[0], readLE64(data));
+            accumulators[1] = xxhRound(accumulators[1], readLE64(data + 8));
+            accumulators[2] = xxhRound(accumulators[2], readLE64(data + 16));
+            accumulators[3] = xxhRound(accumulators[3], readLE64(data + 24));
+        }
+    }
+}
+
+std::optional<HashAlgorithm> parseHashAlgorithm (const std::string& name) {
+    for (HashAlgorithm algorithm : getHashAlgorithms()) {
+        if (getHashAlgorithmName(algorithm) == name) {
+            return algorithm;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string getHashAlgorithmName (HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::CRC32: return "crc32";
+        case HashAlgorithm::CRC32C: return "crc32c";
+        case HashAlgorithm::SHA1: return "sha1";
+        case HashAlgorithm::SHA256: return "sha256";
+        case HashAlgorithm::XXH64: return "xxh64";
+    }
+    return "";
+}
+
+std::vector<HashAlgorithm> getHashAlgorithms () {
+    return {HashAlgorithm::CRC32, HashAlgorithm::CRC32C, HashAlgorithm::SHA1, HashAlgorithm::SHA256, HashAlgorithm::XXH64};
+}
+
+void setHashAcceleration (bool enabled) {
+    acceleration_enabled = enabled;
+}
+
+std::string getHashImplementation (HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::CRC32: return usePCLMUL() ? "pclmul" : "portable";
+        case HashAlgorithm::CRC32C: return useSSE42() ? "sse4.2" : "portable";
+        case HashAlgorithm::SHA1:
+        case HashAlgorithm::SHA256: return useSHA() ? "sha-ni" : "portable";
+        case HashAlgorithm::XXH64: return "portable";
+    }
+    return "";
+}
+
+Hasher::Hasher (HashAlgorithm t_algorithm) : algorithm(t_algorithm) {
+    if (algorithm == HashAlgorithm::SHA1) {
+        sha_state = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0, 0, 0, 0};
+    } else {
+        sha_state = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    }
+    xxh_accumulators = {XXH_PRIME1 + XXH_PRIME2, XXH_PRIME2, 0, 0 - XXH_PRIME1};
+}
+
+void Hasher::update (const Byte* data, size_t size) {
+    total += size;
+
+    if (algorithm == HashAlgorithm::CRC32) {
+        crc = crc32Update(crc, data, size);
+        return;
+    } else if (algorithm == HashAlgorithm::CRC32C) {
+        crc = crc32cUpdate(crc, data, size);
+        return;
+    }
+
+    const size_t block_size = algorithm == HashAlgorithm::XXH64 ? 32 : 64;
+    auto process = [this] (const Byte* blocks, size_t count) {
+        if (algorithm == HashAlgorithm::SHA1) {
+            sha1Blocks(sha_state.data(), blocks, count);
+        } else if (algorithm == HashAlgorithm::SHA256) {
+            sha256Blocks(sha_state.data(), blocks, count);
+        } else {
+            xxhStripes(xxh_accumulators, blocks, count);
+        }
+    };
+
+    // Finish off a partial block from the last update first
+    if (block_used > 0) {
+        size_t amount = std::min(size, block_size - block_used);
+        std::memcpy(block.data() + block_used, data, amount);
+        block_used += amount;
+        data += amount;
+        size -= amount;
+        if (block_used < block_size) {
+            return;
+        }
+        process(block.data(), 1);
+        block_used = 0;
+    }
+
+    // Whole blocks straight from the input, without copying
+    size_t whole = size / block_size;
+    if (whole > 0) {
+        process(data, whole);
+        data += whole * block_size;
+        size -= whole * block_size;
+    }
+
+    std::memcpy(block.data(), data, size);
+    block_used = size;
+}
+
+std::string Hasher::finish () {
+    switch (algorithm) {
+        case HashAlgorithm::CRC32:
+        case HashAlgorithm::CRC32C:
+            return toHex(~crc, 8);
+        case HashAlgorithm::SHA1:
+        case HashAlgorithm::SHA256: {
+            // Padding: a one bit, zeroes up to 56 bytes into the block, then the length in bits as big endian.
+            const uint64_t bit_length = total * 8;
+            std::array<Byte, 72> padding{};
+            padding[0] = 0x80;
+            size_t padding_size = (block_used < 56 ? 56 : 120) - block_used;
+            for (size_t i = 0; i < 8; i++) {
+                padding[padding_size + i] = static_cast<Byte>(bit_length >> (56 - i * 8));
+            }
+            update(padding.data(), padding_size + 8);
+
+            const size_t words = algorithm == HashAlgorithm::SHA1 ? 5 : 8;
+            std::string res;
+            for (size_t i = 0; i < words; i++) {
+                res += toHex(sha_state[i], 8);
+            }
+            return res;
+        }
+        case HashAlgorithm::XXH64: {
+            uint64_t hash;
+            if (total >= 32) {
+                hash = rotl64(xxh_accumulators[0], 1) + rotl64(xxh_accumulators[1], 7) +
+                    rotl64(xxh_accumulators[2], 12) + rotl64(xxh_accumulators[3], 18);
+                for (uint64_t accumulator : xxh_accumulators) {
+                    hash = xxhMergeRound(hash, accumulator);
+                }
+            } else {
+                hash = XXH_PRIME5;
+            }
+            hash += total;
+
+            const Byte* data = block.data();
+            size_t size = block_used;
+            for (; size >= 8; size -= 8, data += 8) {
+                hash ^= xxhRound(0, readLE64(data));
+                hash = rotl64(hash, 27) * XXH_PRIME1 + XXH_PRIME4;
+            }
+            if (size >= 4) {
+                hash ^= static_cast<uint64_t>(readLE32(data)) * XXH_PRIME1;
+                hash = rotl64(hash, 23) * XXH_PRIME2 + XXH_PRIME3;
+                size -= 4;
+                data += 4;
+            }
+            for (; size > 0; size--, data++) {
+                hash ^= *data * XXH_PRIME5;
+                hash = rotl64(hash, 11) * XXH_PRIME1;
+            }
+
+            hash ^= hash >> 33;
+            hash *= XXH_PRIME2;
+            hash ^= hash >> 29;
+            hash *= XXH_PRIME3;
+            hash ^= hash >> 32;
+            return toHex(hash, 16);
+        }
+    }
+    return "";
+}
+
+std::string hashRange (EditLayer& hex, HashAlgorithm algorithm, HerixLib::FilePosition start, size_t length) {
+    Hasher hasher(algorithm);
+    streamRange(hex, start, length, HASH_READ_SIZE, [&hasher] (const Byte* data, size_t size) {
+        hasher.update(data, size);
+    });
+    return hasher.finish();
+}
+
+StreamingHash::StreamingHash (const std::vector<HashAlgorithm>& algorithms, HerixLib::FilePosition t_start, size_t t_length) :
+    start(t_start), length(t_length) {
+    for (HashAlgorithm algorithm : algorithms) {
+        hashers.emplace_back(algorithm);
+    }
+}
+
+bool StreamingHash::step (EditLayer& hex, size_t budget) {
+    if (done) {
+        return true;
+    }
+
+    std::vector<Byte> data;
+    if (progress < length) {
+        data = hex.readMultipleCutoff(start + progress, std::min(std::max<size_t>(budget, 1), length - progress));
+    }
+    if (!data.empty()) {
+        // Every hasher goes over the piece while it's still in cache
+        for (Hasher& hasher : hashers) {
+            hasher.update(data.data(), data.size());
+        }
+        progress += data.size();
+    }
+
+    // Either the whole range, or cut off at the end of the file
+    if (data.empty() || progress >= length) {
+        for (Hasher& hasher : hashers) {
+            digests.push_back(hasher.finish());
+        }
+        done = true;
+    }
+    return done;
+}
+
+bool StreamingHash::isDone () const {
+    return done;
+}
+size_t StreamingHash::getProgress () const {
+    return progress;
+}
+size_t StreamingHash::getLength () const {
+    return length;
+}
+const std::vector<std::string>& StreamingHash::getDigests () const {
+    return digests;
+}
@@ -0,0 +1,82 @@
+#ifndef FILE_SEEN_HASHING
+#define FILE_SEEN_HASHING
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include "./editlayer.hpp"
+
+enum class HashAlgorithm : uint8_t {
+    // The zlib/PNG/zip polynomial
+    CRC32,
+    // Castagnoli, as used by iSCSI, ext4 and btrfs
+    CRC32C,
+    SHA1,
+    SHA256,
+    // xxHash64 with a seed of 0
+    XXH64,
+};
+
+// Takes the names that the lua side uses: "crc32", "crc32c", "sha1", "sha256" and "xxh64".
+std::optional<HashAlgorithm> parseHashAlgorithm (const std::string& name);
+std::string getHashAlgorithmName (HashAlgorithm algorithm);
+std::vector<HashAlgorithm> getHashAlgorithms ();
+
+// The CPU extensions are detected once, and used unless this is turned off. Mostly for comparing against the
+// portable versions.
+void setHashAcceleration (bool enabled);
+// Name of the implementation that would be used for the algorithm right now, e.g. "sha-ni" or "portable".
+std::string getHashImplementation (HashAlgorithm algorithm);
+
+// Incremental hasher, so ranges can be hashed without being read into memory all at once.
+class Hasher {
+    public:
+    explicit Hasher (HashAlgorithm t_algorithm);
+
+    void update (const HerixLib::Byte* data, size_t size);
+    // The digest as lowercase hex, in the same form the usual command line tools print it.
+    // The hasher should not be updated after this.
+    std::string finish ();
+
+    private:
+    HashAlgorithm algorithm;
+    uint64_t total = 0;
+    uint32_t crc = 0xFFFFFFFF;
+    // SHA-1 uses the first five
+    std::array<uint32_t, 8> sha_state;
+    std::array<uint64_t, 4> xxh_accumulators;
+    // Partial block for the SHA family (64 bytes) and xxHash (32 bytes)
+    std::array<HerixLib::Byte, 64> block;
+    size_t block_used = 0;
+};
+
+// Hashes [start, start + length) as currently edited, cut off at the end of the file.
+std::string hashRange (EditLayer& hex, HashAlgorithm algorithm, HerixLib::FilePosition start, size_t length);
+
+// Hashes a range with several algorithms in a single pass over it, a piece at a time, so that a large file can be
+// hashed over many calls without blocking the editor.
+class StreamingHash {
+    public:
+    StreamingHash (const std::vector<HashAlgorithm>& algorithms, HerixLib::FilePosition t_start, size_t t_length);
+
+    // Hashes the next (up to) budget bytes with every algorithm. Returns true once the whole range has been hashed.
+    bool step (EditLayer& hex, size_t budget);
+    bool isDone () const;
+    // How many bytes of the range have been hashed
+    size_t getProgress () const;
+    size_t getLength () const;
+    // The digests, in the same order as the algorithms it was given. Empty until it is done.
+    const std::vector<std::string>& getDigests () const;
+
+    private:
+    std::vector<Hasher> hashers;
+    HerixLib::FilePosition start;
+    size_t length;
+    size_t progress = 0;
+    std::vector<std::string> digests;
+    bool done = false;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "./histogram.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "./mutil.hpp"
+
+// Counting into a single table stalls whenever neighbouring bytes are equal (which is common, e.g. runs of zeroes),
+// since each increment has to wait for the previous store to the same counter.
+// Spreading the bytes over four tables lets those increments happen independently, and reading eight bytes at a
+// time means only one load per eight counts.
+void countBytes (const HerixLib::Byte* data, size_t size, ByteHistogram& hist) {
+    // uint32_t keeps the tables in L1, so flush into hist before they could overflow.
+    constexpr size_t MAX_RUN = size_t(1) << 30;
+    std::array<std::array<uint32_t, 256>, 4> tables;
+
+    while (size > 0) {
+        size_t run = size < MAX_RUN ? size : MAX_RUN;
+        for (auto& table : tables) {
+            table.fill(0);
+        }
+
+        size_t i = 0;
+        for (; i + 8 <= run; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            tables[0][word & 0xFF]++;
+            tables[1][(word >> 8) & 0xFF]++;
+            tables[2][(word >> 16) & 0xFF]++;
+            tables[3][(word >> 24) & 0xFF]++;
+            tables[0][(word >> 32) & 0xFF]++;
+            tables[1][(word >> 40) & 0xFF]++;
+            tables[2][(word >> 48) & 0xFF]++;
+            tables[3][word >> 56]++;
+        }
+        for (; i < run; i++) {
+            tables[0][data[i]]++;
+        }
+
+        for (size_t v = 0; v < 256; v++) {
+            hist[v] += static_cast<uint64_t>(tables[0][v]) + tables[1][v] + tables[2][v] + tables[3][v];
+        }
+
+        data += run;
+        size -= run;
+    }
+}
+
+double shannonEntropy (const ByteHistogram& hist, uint64_t total) {
+    if (total == 0) {
+        return 0.0;
+    }
+
+    double entropy = 0.0;
+    const double total_d = static_cast<double>(total);
+    for (uint64_t count : hist) {
+        if (count != 0) {
+            double p = static_cast<double>(count) / total_d;
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy;
+}
+
+namespace {
+    constexpr size_t STATS_CHUNK_SIZE = 1024 * 1024;
+
+    // Runs of zeroes over a bitmask where bit i is set if byte i is zero, continuing on from stats.trailing_zeroes.
+    void addZeroRunMask (uint64_t mask, size_t bits, RangeStats& stats) {
+        size_t pos = 0;
+        while (pos < bits) {
+            uint64_t rest = mask >> pos;
+            // Zeroes starting at pos
+            size_t zeroes = (~rest == 0) ? 64 - pos : static_cast<size_t>(__builtin_ctzll(~rest));
+            zeroes = std::min(zeroes, bits - pos);
+            if (zeroes > 0) {
+                if (stats.trailing_zeroes == 0) {
+                    stats.zero_runs++;
+                }
+                stats.trailing_zeroes += zeroes;
+                pos += zeroes;
+                if (pos >= bits) {
+                    break;
+                }
+            }
+
+            // A non-zero byte at pos ends the run
+            stats.longest_zero_run = std::max(stats.longest_zero_run, stats.trailing_zeroes);
+            stats.trailing_zeroes = 0;
+            rest = mask >> pos;
+            pos = rest == 0 ? bits : pos + static_cast<size_t>(__builtin_ctzll(rest));
+        }
+    }
+
+    // The zero runs are what can't be derived from the histogram. Compares 64 bytes at a time against zero, so that
+    // the common cases of data with no zeroes and long stretches of padding each cost a few instructions per block.
+    // SSE2 is part of x86-64, so there's nothing to detect.
+    void scanZeroRuns (const HerixLib::Byte* data, size_t size, RangeStats& stats) {
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 64 <= size; i += 64) {
+            uint64_t mask = 0;
+            for (size_t lane = 0; lane < 4; lane++) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + lane * 16));
+                uint64_t lane_mask = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)));
+                mask |= lane_mask << (lane * 16);
+            }
+
+            if (mask == 0) {
+                if (stats.trailing_zeroes != 0) {
+                    stats.longest_zero_run = std::max(stats.longest_zero_run, stats.trailing_zeroes);
+                    stats.trailing_zeroes = 0;
+                }
+            } else if (mask == ~uint64_t(0)) {
+                if (stats.trailing_zeroes == 0) {
+                    stats.zero_runs++;
+                }
+                stats.trailing_zeroes += 64;
+            } else {
+                addZeroRunMask(mask, 64, stats);
+            }
+        }
+#endif
+        for (; i < size; i += 64) {
+            size_t bits = std::min<size_t>(64, size - i);
+            uint64_t mask = 0;
+            for (size_t j = 0; j < bits; j++) {
+                mask |= static_cast<uint64_t>(data[i + j] == 0) << j;
+            }
+            addZeroRunMask(mask, bits, stats);
+        }
+    }
+}
+
+RangeStats RangeStats::fromBytes (const HerixLib::Byte* data, size_t size) {
+    RangeStats stats;
+    stats.total = size;
+    countBytes(data, size, stats.histogram);
+
+    // Scanned as if it were appended onto an empty range, then the leading run is found from the first run.
+    scanZeroRuns(data, size, stats);
+    stats.longest_zero_run = std::max(stats.longest_zero_run, stats.trailing_zeroes);
+    if (stats.histogram[0] == size) {
+        stats.leading_zeroes = size;
+    } else {
+        while (data[stats.leading_zeroes] == 0) {
+            stats.leading_zeroes++;
+        }
+    }
+    return stats;
+}
+
+void RangeStats::append (const RangeStats& next) {
+    for (size_t v = 0; v < 256; v++) {
+        histogram[v] += next.histogram[v];
+    }
+
+    zero_runs += next.zero_runs;
+    longest_zero_run = std::max(longest_zero_run, next.longest_zero_run);
+    if (trailing_zeroes != 0 && next.leading_zeroes != 0) {
+        // The run crossing the boundary was counted on both sides
+        zero_runs--;
+        longest_zero_run = std::max(longest_zero_run, trailing_zeroes + next.leading_zeroes);
+    }
+
+    if (leading_zeroes == total) {
+        leading_zeroes += next.leading_zeroes;
+    }
+    if (next.trailing_zeroes == next.total) {
+        trailing_zeroes += next.total;
+    } else {
+        trailing_zeroes = next.trailing_zeroes;
+    }
+    total += next.total;
+}
+
+std::optional<HerixLib::Byte> RangeStats::getMin () const {
+    for (size_t v = 0; v < 256; v++) {
+        if (histogram[v] != 0) {
+            return static_cast<HerixLib::Byte>(v);
+        }
+    }
+    return std::nullopt;
+}
+std::optional<HerixLib::Byte> RangeStats::getMax () const {
+    for (size_t v = 256; v > 0; v--) {
+        if (histogram[v - 1] != 0) {
+            return static_cast<HerixLib::Byte>(v - 1);
+        }
+    }
+    return std::nullopt;
+}
+uint64_t RangeStats::getPrintable () const {
+    uint64_t printable = 0;
+    for (size_t v = 32; v <= 126; v++) {
+        printable += histogram[v];
+    }
+    return printable;
+}
+double RangeStats::getPrintableRatio () const {
+    return total == 0 ? 0.0 : static_cast<double>(getPrintable()) / static_cast<double>(total);
+}
+double RangeStats::getEntropy () const {
+    return shannonEntropy(histogram, total);
+}
+
+RangeStats computeRangeStats (EditLayer& hex, HerixLib::FilePosition start, size_t length, unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t batch_size = STATS_CHUNK_SIZE * threads;
+
+    RangeStats stats;
+    streamRange(hex, start, length, batch_size, [&] (const HerixLib::Byte* data, size_t size) {
+        const size_t chunk_count = (size + STATS_CHUNK_SIZE - 1) / STATS_CHUNK_SIZE;
+        std::vector<RangeStats> chunk_stats(chunk_count);
+
+        auto worker = [&] (size_t first_chunk) {
+            for (size_t c = first_chunk; c < chunk_count; c += threads) {
+                size_t offset = c * STATS_CHUNK_SIZE;
+                chunk_stats[c] = RangeStats::fromBytes(data + offset, std::min(STATS_CHUNK_SIZE, size - offset));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < std::min<size_t>(threads, chunk_count); t++) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (std::thread& thread : workers) {
+            thread.join();
+        }
+
+        // In order, so that zero runs crossing chunks are joined
+        for (const RangeStats& chunk : chunk_stats) {
+            stats.append(chunk);
+        }
+    });
+    return stats;
+}
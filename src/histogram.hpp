@@ -0,0 +1,48 @@
+#ifndef FILE_SEEN_HISTOGRAM
+#define FILE_SEEN_HISTOGRAM
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include "./editlayer.hpp"
+
+using ByteHistogram = std::array<uint64_t, 256>;
+
+// Adds the count of every byte value in data onto hist.
+void countBytes (const HerixLib::Byte* data, size_t size, ByteHistogram& hist);
+
+// Shannon entropy in bits per byte, in [0, 8].
+double shannonEntropy (const ByteHistogram& hist, uint64_t total);
+
+// Statistics over a range of bytes, used for guessing what an unknown blob is.
+// Everything besides the zero runs is derived from the histogram.
+struct RangeStats {
+    ByteHistogram histogram{};
+    uint64_t total = 0;
+    // Runs of consecutive zero bytes
+    uint64_t zero_runs = 0;
+    uint64_t longest_zero_run = 0;
+    // Length of the runs touching either end, so a run crossing into the next range can be joined in append().
+    // Both are equal to total when every byte is zero.
+    uint64_t leading_zeroes = 0;
+    uint64_t trailing_zeroes = 0;
+
+    static RangeStats fromBytes (const HerixLib::Byte* data, size_t size);
+    // Adds on the stats of the range which directly follows this one.
+    void append (const RangeStats& next);
+
+    // No value when the range is empty
+    std::optional<HerixLib::Byte> getMin () const;
+    std::optional<HerixLib::Byte> getMax () const;
+    // Printable ascii, [32, 126]
+    uint64_t getPrintable () const;
+    double getPrintableRatio () const;
+    double getEntropy () const;
+};
+
+// Stats of [start, start + length), cut off at the end of the file. The range is read in batches of
+// (threads * chunk_size) bytes which are counted in parallel, so memory use stays bounded for any size.
+// 0 threads means to use however many the hardware has.
+RangeStats computeRangeStats (EditLayer& hex, HerixLib::FilePosition start, size_t length, unsigned int threads = 0);
+
+#endif
@@ -0,0 +1,182 @@
+#include "./inspectorview.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // Unsigned value of `size` bytes, if there are enough of them.
+    std::optional<uint64_t> readUnsigned (const HerixLib::Byte* data, size_t available, size_t size, bool little_endian) {
+        if (available < size) {
+            return std::nullopt;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; i++) {
+            size_t index = little_endian ? size - 1 - i : i;
+            value = (value << 8) | data[index];
+        }
+        return value;
+    }
+
+    // Sign extends the low `size` bytes
+    int64_t toSigned (uint64_t value, size_t size) {
+        if (size < 8) {
+            uint64_t sign_bit = uint64_t(1) << (size * 8 - 1);
+            if ((value & sign_bit) != 0) {
+                value |= ~((sign_bit << 1) - 1);
+            }
+        }
+        int64_t ret;
+        std::memcpy(&ret, &value, sizeof(ret));
+        return ret;
+    }
+
+    std::string formatUnsigned (const HerixLib::Byte* data, size_t available, size_t size, bool little_endian) {
+        std::optional<uint64_t> value = readUnsigned(data, available, size, little_endian);
+        return value.has_value() ? std::to_string(value.value()) : "-";
+    }
+    std::string formatSigned (const HerixLib::Byte* data, size_t available, size_t size, bool little_endian) {
+        std::optional<uint64_t> value = readUnsigned(data, available, size, little_endian);
+        return value.has_value() ? std::to_string(toSigned(value.value(), size)) : "-";
+    }
+
+    std::string formatFloat (const HerixLib::Byte* data, size_t available, bool little_endian) {
+        std::optional<uint64_t> value = readUnsigned(data, available, 4, little_endian);
+        if (!value.has_value()) {
+            return "-";
+        }
+        uint32_t bits = static_cast<uint32_t>(value.value());
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.7g", static_cast<double>(result));
+        return buffer;
+    }
+    std::string formatDouble (const HerixLib::Byte* data, size_t available, bool little_endian) {
+        std::optional<uint64_t> value = readUnsigned(data, available, 8, little_endian);
+        if (!value.has_value()) {
+            return "-";
+        }
+        uint64_t bits = value.value();
+        double result;
+        std::memcpy(&result, &bits, sizeof(result));
+
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.15g", result);
+        return buffer;
+    }
+
+    // Seconds since the unix epoch, as UTC
+    std::string formatUnixTime (const HerixLib::Byte* data, size_t available) {
+        std::optional<uint64_t> value = readUnsigned(data, available, 4, true);
+        if (!value.has_value()) {
+            return "-";
+        }
+        std::time_t seconds = static_cast<std::time_t>(value.value());
+        std::tm time;
+        if (gmtime_r(&seconds, &time) == nullptr) {
+            return "-";
+        }
+
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &time);
+        return buffer;
+    }
+
+    // LEB128, with how many bytes it took up. Gives up past 10 bytes, which is all a 64 bit value needs.
+    std::string formatLEB128 (const HerixLib::Byte* data, size_t available, bool is_signed) {
+        uint64_t value = 0;
+        size_t shift = 0;
+        for (size_t i = 0; i < std::min<size_t>(available, 10); i++) {
+            HerixLib::Byte byte = data[i];
+            if (shift < 64) {
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
+            shift += 7;
+
+            if ((byte & 0x80) == 0) {
+                std::string text;
+                if (is_signed) {
+                    if (shift < 64 && (byte & 0x40) != 0) {
+                        value |= ~uint64_t(0) << shift;
+                    }
+                    int64_t signed_value;
+                    std::memcpy(&signed_value, &value, sizeof(signed_value));
+                    text = std::to_string(signed_value);
+                } else {
+                    text = std::to_string(value);
+                }
+                return text + " (" + std::to_string(i + 1) + "B)";
+            }
+        }
+        return "-";
+    }
+}
+
+DataInspectorView::DataInspectorView (size_t t_sub_view_id) : sub_view_id(t_sub_view_id) {}
+
+bool DataInspectorView::update (HerixLib::FilePosition pos, const HerixLib::Byte* data, size_t size) {
+    size = std::min(size, MAX_BYTES);
+    if (position == pos && byte_count == size && std::memcmp(bytes.data(), data, size) == 0) {
+        return false;
+    }
+
+    position = pos;
+    byte_count = size;
+    std::memcpy(bytes.data(), data, size);
+    decode();
+    return true;
+}
+
+const std::vector<std::pair<std::string, std::string>>& DataInspectorView::getFields () const {
+    return fields;
+}
+
+void DataInspectorView::decode () {
+    const HerixLib::Byte* data = bytes.data();
+    const size_t available = byte_count;
+
+    fields.clear();
+    fields.emplace_back("u8", formatUnsigned(data, available, 1, true));
+    fields.emplace_back("i8", formatSigned(data, available, 1, true));
+    fields.emplace_back("u16", formatUnsigned(data, available, 2, true));
+    fields.emplace_back("i16", formatSigned(data, available, 2, true));
+    fields.emplace_back("u32", formatUnsigned(data, available, 4, true));
+    fields.emplace_back("i32", formatSigned(data, available, 4, true));
+    fields.emplace_back("u64", formatUnsigned(data, available, 8, true));
+    fields.emplace_back("i64", formatSigned(data, available, 8, true));
+    fields.emplace_back("f32", formatFloat(data, available, true));
+    fields.emplace_back("f64", formatDouble(data, available, true));
+    fields.emplace_back("time", formatUnixTime(data, available));
+    fields.emplace_back("uleb", formatLEB128(data, available, false));
+    fields.emplace_back("sleb", formatLEB128(data, available, true));
+    // Big endian after, since little endian is what's more commonly wanted
+    fields.emplace_back("u16be", formatUnsigned(data, available, 2, false));
+    fields.emplace_back("i16be", formatSigned(data, available, 2, false));
+    fields.emplace_back("u32be", formatUnsigned(data, available, 4, false));
+    fields.emplace_back("i32be", formatSigned(data, available, 4, false));
+    fields.emplace_back("u64be", formatUnsigned(data, available, 8, false));
+    fields.emplace_back("i64be", formatSigned(data, available, 8, false));
+    fields.emplace_back("f32be", formatFloat(data, available, false));
+    fields.emplace_back("f64be", formatDouble(data, available, false));
+}
+
+void DataInspectorView::render (SubView& sub_view) const {
+    const size_t height = static_cast<size_t>(std::max(sub_view.getHeight(), 0));
+    const size_t width = static_cast<size_t>(std::max(sub_view.getWidth(), 0));
+    if (width < 2) {
+        return;
+    }
+
+    for (size_t row = 0; row < std::min(height, fields.size()); row++) {
+        // A space of separation from whatever is to the left
+        std::string line = " " + fields[row].first;
+        line.resize(std::max<size_t>(line.size() + 1, 7), ' ');
+        line += fields[row].second;
+        line.resize(width, ' ');
+
+        sub_view.move(0, static_cast<int>(row));
+        sub_view.print(line);
+    }
+}
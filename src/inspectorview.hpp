@@ -0,0 +1,41 @@
+#ifndef FILE_SEEN_INSPECTORVIEW
+#define FILE_SEEN_INSPECTORVIEW
+
+#include <array>
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include "./subview.hpp"
+
+// Shows the bytes at the cursor as integers, floats, a unix time and varints.
+// The bytes come from the buffer the hex view was drawn from, so showing it costs no extra reads, and the fields
+// are only decoded again when the cursor or the bytes under it change.
+class DataInspectorView {
+    public:
+    // Enough for the largest field, a 64 bit varint (10 bytes)
+    static constexpr size_t MAX_BYTES = 16;
+
+    size_t sub_view_id;
+
+    explicit DataInspectorView (size_t t_sub_view_id);
+
+    // Takes the bytes starting at the cursor. size can be less than MAX_BYTES near the end of the file.
+    // Returns true if the fields changed.
+    bool update (HerixLib::FilePosition pos, const HerixLib::Byte* data, size_t size);
+
+    // Pairs of (name, value), most commonly wanted first, since they're cut off by the height of the view.
+    const std::vector<std::pair<std::string, std::string>>& getFields () const;
+
+    void render (SubView& sub_view) const;
+
+    private:
+    std::optional<HerixLib::FilePosition> position = std::nullopt;
+    std::array<HerixLib::Byte, MAX_BYTES> bytes{};
+    size_t byte_count = 0;
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    void decode ();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "./keyhandlers.hpp"
+
+#include <algorithm>
+
+size_t KeyHandlerTable::SlotHash::operator() (const Slot& slot) const {
+    // The states are tiny, so they fit in above the key without colliding for any key curses produces
+    size_t hash = static_cast<size_t>(static_cast<unsigned int>(slot.key));
+    hash = hash * 31 + static_cast<size_t>(static_cast<unsigned int>(slot.ui_state));
+    hash = hash * 31 + static_cast<size_t>(static_cast<unsigned int>(slot.hex_view_state));
+    return hash;
+}
+
+void KeyHandlerTable::add (unsigned int id, int key, int ui_state, int hex_view_state) {
+    Slot slot{key, ui_state, hex_view_state};
+    table[slot].push_back(id);
+    slots[id] = slot;
+}
+
+bool KeyHandlerTable::remove (unsigned int id) {
+    auto slot_iter = slots.find(id);
+    if (slot_iter == slots.end()) {
+        return false;
+    }
+
+    auto iter = table.find(slot_iter->second);
+    std::vector<unsigned int>& ids = iter->second;
+    ids.erase(std::find(ids.begin(), ids.end(), id));
+    if (ids.empty()) {
+        table.erase(iter);
+    }
+    slots.erase(slot_iter);
+    return true;
+}
+
+bool KeyHandlerTable::contains (unsigned int id) const {
+    return slots.count(id) != 0;
+}
+
+size_t KeyHandlerTable::getCount () const {
+    return slots.size();
+}
+
+void KeyHandlerTable::collect (int key, int ui_state, int hex_view_state, std::vector<unsigned int>& out) const {
+    out.clear();
+
+    size_t found_in = 0;
+    for (int k : {key, ANY}) {
+        for (int u : {ui_state, ANY}) {
+            for (int h : {hex_view_state, ANY}) {
+                auto iter = table.find(Slot{k, u, h});
+                if (iter != table.end()) {
+                    out.insert(out.end(), iter->second.begin(), iter->second.end());
+                    found_in++;
+                }
+            }
+        }
+    }
+
+    // Each slot is already in order, they only need to be interleaved
+    if (found_in > 1) {
+        std::sort(out.begin(), out.end());
+    }
+}
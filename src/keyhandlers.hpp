@@ -0,0 +1,45 @@
+#ifndef FILE_SEEN_KEYHANDLERS
+#define FILE_SEEN_KEYHANDLERS
+
+#include <vector>
+#include <cstddef>
+#include <unordered_map>
+
+// Which key handlers want a key, indexed by the key and the states they were registered for, so that a keypress
+// only looks at the handlers which could want it rather than every one there is.
+// Handlers are referred to by id. Ids have to increase in the order handlers are added, since that is the order
+// they are returned in (and so ran in).
+class KeyHandlerTable {
+    public:
+    // For the key, or either of the states, to match anything
+    static constexpr int ANY = -1;
+
+    void add (unsigned int id, int key, int ui_state, int hex_view_state);
+    // Returns false if there was no handler with the id
+    bool remove (unsigned int id);
+    bool contains (unsigned int id) const;
+    size_t getCount () const;
+
+    // Replaces the contents of out with the handlers for the key in these states, in the order they were added.
+    void collect (int key, int ui_state, int hex_view_state, std::vector<unsigned int>& out) const;
+
+    private:
+    struct Slot {
+        int key;
+        int ui_state;
+        int hex_view_state;
+
+        bool operator== (const Slot& other) const {
+            return key == other.key && ui_state == other.ui_state && hex_view_state == other.hex_view_state;
+        }
+    };
+    struct SlotHash {
+        size_t operator() (const Slot& slot) const;
+    };
+
+    std::unordered_map<Slot, std::vector<unsigned int>, SlotHash> table;
+    // Where each handler is, for removing it
+    std::unordered_map<unsigned int, Slot> slots;
+};
+
+#endif
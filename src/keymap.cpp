@@ -0,0 +1,109 @@
+#include "./keymap.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+namespace {
+    struct ActionInfo {
+        KeyAction action;
+        const char* name;
+        std::vector<int> default_keys;
+    };
+
+    constexpr int ctrl (char c) {
+        return c & 0x1F;
+    }
+
+    // In the same order as KeyAction, so an action's entry can be found by its value
+    const std::vector<ActionInfo>& getActions () {
+        static const std::vector<ActionInfo> actions = {
+            {KeyAction::Exit, "exit", {'q', 'Q'}},
+            {KeyAction::Yes, "yes", {'y', 'Y'}},
+            {KeyAction::Question, "question", {'?'}},
+            {KeyAction::Up, "up", {KEY_UP, 'k', 'K'}},
+            {KeyAction::Down, "down", {KEY_DOWN, 'j', 'J'}},
+            {KeyAction::Left, "left", {KEY_LEFT, 'h', 'H'}},
+            {KeyAction::Right, "right", {KEY_RIGHT, 'l', 'L'}},
+            {KeyAction::Enter, "enter", {KEY_ENTER, '\n'}},
+            {KeyAction::Save, "save", {ctrl('S')}},
+            {KeyAction::EndOfFile, "end_of_file", {'g', 'G'}},
+            {KeyAction::PageDown, "page_down", {KEY_NPAGE}},
+            {KeyAction::PageUp, "page_up", {KEY_PPAGE}},
+            {KeyAction::End, "end", {KEY_END, KEY_SEND}},
+            {KeyAction::Home, "home", {KEY_HOME, KEY_SHOME}},
+            {KeyAction::Undo, "undo", {'u', 'U', ctrl('Z')}},
+            {KeyAction::Redo, "redo", {'r', 'R', ctrl('Y')}},
+            {KeyAction::Strings, "strings", {'"'}},
+            {KeyAction::Minimap, "minimap", {'m', 'M'}},
+            {KeyAction::ZoomIn, "zoom_in", {'+', '='}},
+            {KeyAction::ZoomOut, "zoom_out", {'-', '_'}},
+            {KeyAction::Inspector, "inspector", {'i', 'I'}},
+            {KeyAction::InsertMode, "insert_mode", {KEY_IC}},
+            {KeyAction::Delete, "delete", {KEY_DC}},
+            {KeyAction::Backspace, "backspace", {KEY_BACKSPACE, 127, '\b'}},
+            {KeyAction::NextHunk, "next_hunk", {'n'}},
+            {KeyAction::PreviousHunk, "previous_hunk", {'N'}},
+            {KeyAction::Command, "command", {':'}},
+            {KeyAction::FrameTimes, "frame_times", {KEY_F(12)}},
+        };
+        return actions;
+    }
+}
+
+Keymap::Keymap () {
+    for (const ActionInfo& info : getActions()) {
+        for (int key : info.default_keys) {
+            bind(info.action, key);
+        }
+    }
+}
+
+void Keymap::bind (KeyAction action, int key) {
+    if (key >= 0 && static_cast<size_t>(key) < bindings.size()) {
+        bindings[static_cast<size_t>(key)] |= uint32_t(1) << static_cast<uint32_t>(action);
+    }
+}
+
+void Keymap::clear (KeyAction action) {
+    for (uint32_t& actions : bindings) {
+        actions &= ~(uint32_t(1) << static_cast<uint32_t>(action));
+    }
+}
+
+const char* Keymap::getActionName (KeyAction action) {
+    return getActions().at(static_cast<size_t>(action)).name;
+}
+
+std::optional<KeyAction> Keymap::parseAction (const std::string& name) {
+    for (const ActionInfo& info : getActions()) {
+        if (name == info.name) {
+            return info.action;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<int> Keymap::parseKey (const std::string& name) {
+    if (name.size() == 1) {
+        return static_cast<unsigned char>(name[0]);
+    }
+
+    // Only needed while reading the configuration, so it's fine to build it on first use
+    static const std::unordered_map<std::string, int> names = [] () {
+        std::unordered_map<std::string, int> result;
+        for (int key = 0; key <= KEY_MAX; key++) {
+            const char* key_name = keyname(key);
+            if (key_name != nullptr) {
+                // Several codes can share a name, the first (lowest) one is kept
+                result.emplace(key_name, key);
+            }
+        }
+        return result;
+    }();
+
+    auto iter = names.find(name);
+    if (iter == names.end()) {
+        return std::nullopt;
+    }
+    return iter->second;
+}
@@ -0,0 +1,72 @@
+#ifndef FILE_SEEN_KEYMAP
+#define FILE_SEEN_KEYMAP
+
+#include <array>
+#include <string>
+#include <cstdint>
+#include <optional>
+#include <curses.h>
+
+// Everything a key can be bound to. Kept under 32, since a key's actions are stored as bits.
+enum class KeyAction : uint8_t {
+    Exit,
+    Yes,
+    Question,
+    Up,
+    Down,
+    Left,
+    Right,
+    Enter,
+    Save,
+    EndOfFile,
+    PageDown,
+    PageUp,
+    End,
+    Home,
+    Undo,
+    Redo,
+    Strings,
+    Minimap,
+    ZoomIn,
+    ZoomOut,
+    Inspector,
+    InsertMode,
+    Delete,
+    Backspace,
+    NextHunk,
+    PreviousHunk,
+    Command,
+    FrameTimes,
+    Count,
+};
+
+// Which actions each key code is bound to, as a flat table indexed by the key, so checking a key is a load and a
+// mask. Built once at startup, from the defaults and then whatever the configuration rebinds.
+class Keymap {
+    public:
+    // With the default bindings
+    Keymap ();
+
+    bool is (int key, KeyAction action) const {
+        if (key < 0 || static_cast<size_t>(key) >= bindings.size()) {
+            return false;
+        }
+        return (bindings[static_cast<size_t>(key)] & (uint32_t(1) << static_cast<uint32_t>(action))) != 0;
+    }
+
+    void bind (KeyAction action, int key);
+    // Unbinds every key from the action
+    void clear (KeyAction action);
+
+    // The name used in the configuration, such as "undo" or "next_hunk"
+    static const char* getActionName (KeyAction action);
+    static std::optional<KeyAction> parseAction (const std::string& name);
+    // A single character, or a name as curses' keyname() gives them ("^S", "KEY_UP", "KEY_NPAGE", ...)
+    static std::optional<int> parseKey (const std::string& name);
+
+    private:
+    // KEY_MAX is the highest code curses gives out
+    std::array<uint32_t, KEY_MAX + 1> bindings{};
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "./luasandbox.hpp"
+
+#include <array>
+#include <algorithm>
+
+namespace {
+    // A global and the library which provides it. Some libraries provide more than one, or go by another name
+    // depending on the lua version.
+    struct LibraryGlobal {
+        const char* name;
+        sol::lib library;
+        const char* library_name;
+    };
+
+    constexpr std::array<LibraryGlobal, 11> LIBRARY_GLOBALS = {{
+        {"bit32", sol::lib::bit32, "bit32"},
+        // LuaJIT's name for it
+        {"bit", sol::lib::bit32, "bit32"},
+        {"debug", sol::lib::debug, "debug"},
+        {"ffi", sol::lib::ffi, "ffi"},
+        {"io", sol::lib::io, "io"},
+        {"jit", sol::lib::jit, "jit"},
+        {"os", sol::lib::os, "os"},
+        {"package", sol::lib::package, "package"},
+        {"require", sol::lib::package, "package"},
+        {"module", sol::lib::package, "package"},
+        {"utf8", sol::lib::utf8, "utf8"},
+    }};
+
+    // Base functions which run code from files or strings outside of the environment, or swap environments
+    constexpr std::array<const char*, 6> HIDDEN_BASE = {{
+        "dofile", "loadfile", "load", "loadstring", "getfenv", "setfenv",
+    }};
+
+    const LibraryGlobal* findLibraryGlobal (const std::string& name) {
+        for (const LibraryGlobal& global : LIBRARY_GLOBALS) {
+            if (name == global.name) {
+                return &global;
+            }
+        }
+        return nullptr;
+    }
+
+    bool isHiddenBase (const std::string& name) {
+        return std::find_if(HIDDEN_BASE.begin(), HIDDEN_BASE.end(), [&name] (const char* hidden) {
+            return name == hidden;
+        }) != HIDDEN_BASE.end();
+    }
+}
+
+void LuaSandbox::setup (sol::state& lua) {
+    lua.open_libraries(sol::lib::base, sol::lib::string, sol::lib::table, sol::lib::math);
+
+    sol::table meta = lua.create_table();
+    meta[sol::meta_function::index] = [this] (sol::this_state state, sol::table globals, sol::object key) -> sol::object {
+        if (key.get_type() == sol::type::string) {
+            std::string name = key.as<std::string>();
+            const LibraryGlobal* global = findLibraryGlobal(name);
+            if (global != nullptr && std::find(opened_libraries.begin(), opened_libraries.end(), global->library_name) == opened_libraries.end()) {
+                opened_libraries.push_back(global->library_name);
+                sol::state_view(state).open_libraries(sol::lib(global->library));
+                return globals.raw_get<sol::object>(name);
+            }
+        }
+        return sol::make_object(state, sol::lua_nil);
+    };
+    lua.globals()[sol::metatable_key] = meta;
+}
+
+void LuaSandbox::setProfile (LuaLibraryProfile t_profile) {
+    profile = t_profile;
+}
+LuaLibraryProfile LuaSandbox::getProfile () const {
+    return profile;
+}
+
+std::optional<LuaLibraryProfile> LuaSandbox::parseProfile (const std::string& name) {
+    if (name == "full") {
+        return LuaLibraryProfile::Full;
+    } else if (name == "minimal") {
+        return LuaLibraryProfile::Minimal;
+    }
+    return std::nullopt;
+}
+
+std::optional<sol::environment> LuaSandbox::createEnvironment (sol::state& lua, const std::vector<std::string>& granted, std::vector<std::string>& unknown) const {
+    std::vector<std::string> granted_libraries;
+    for (const std::string& name : granted) {
+        const LibraryGlobal* global = findLibraryGlobal(name);
+        if (global == nullptr) {
+            unknown.push_back(name);
+        } else {
+            granted_libraries.push_back(global->library_name);
+        }
+    }
+
+    if (profile == LuaLibraryProfile::Full) {
+        return std::nullopt;
+    }
+
+    sol::environment environment(lua, sol::create);
+    sol::table meta = lua.create_table();
+    meta[sol::meta_function::index] = [granted_libraries] (sol::this_state state, sol::table, sol::object key) -> sol::object {
+        if (key.get_type() == sol::type::string) {
+            std::string name = key.as<std::string>();
+            const LibraryGlobal* global = findLibraryGlobal(name);
+            bool hidden = global != nullptr ?
+                std::find(granted_libraries.begin(), granted_libraries.end(), global->library_name) == granted_libraries.end() :
+                isHiddenBase(name);
+            if (hidden) {
+                return sol::make_object(state, sol::lua_nil);
+            }
+        }
+        // Through the globals' own metatable, so granted libraries are opened on use as well
+        return sol::state_view(state).globals().get<sol::object>(key);
+    };
+    meta[sol::meta_function::new_index] = lua.globals();
+    // So it can't be taken off from inside
+    meta["__metatable"] = false;
+    environment[sol::metatable_key] = meta;
+    // Otherwise _G would be looked up in the globals, and used to get around the environment
+    environment.raw_set("_G", environment);
+    return environment;
+}
+
+const std::vector<std::string>& LuaSandbox::getOpenedLibraries () const {
+    return opened_libraries;
+}
@@ -0,0 +1,52 @@
+#ifndef FILE_SEEN_LUASANDBOX
+#define FILE_SEEN_LUASANDBOX
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weverything"
+
+#define SOL_ALL_SAFETIES_ON 1
+#include "./sol.hpp"
+
+#pragma GCC diagnostic pop
+
+#include <string>
+#include <vector>
+#include <optional>
+
+enum class LuaLibraryProfile {
+    // Plugins can use every library
+    Full,
+    // Plugins only get base, string, table and math, plus what the editor provides
+    Minimal,
+};
+
+// Which lua libraries are opened, and what plugins can see of them.
+// Only base, string, table and math are opened at startup. The rest (io, os, debug, ffi, jit, package, ...) are
+// opened the first time a global by their name is looked up, so they cost nothing unless something uses them.
+// With the minimal profile each plugin is run in its own environment, which hides the other libraries and the base
+// functions which load code from outside of it, unless the plugin's entry in the plugins list grants them. Globals
+// assigned in the environment still go to the real globals, since that's how plugins share functions with each
+// other and how the editor finds their hooks.
+class LuaSandbox {
+    public:
+    // Opens the minimal set, and sets up opening the rest on use
+    void setup (sol::state& lua);
+
+    void setProfile (LuaLibraryProfile t_profile);
+    LuaLibraryProfile getProfile () const;
+    // "full" or "minimal"
+    static std::optional<LuaLibraryProfile> parseProfile (const std::string& name);
+
+    // The environment to run a plugin in, with access to the granted libraries ("io", "os", ...), or nullopt if it
+    // should just run in the globals. Names which aren't libraries are returned in unknown.
+    std::optional<sol::environment> createEnvironment (sol::state& lua, const std::vector<std::string>& granted, std::vector<std::string>& unknown) const;
+
+    // The libraries which were opened on use, in order, for logging
+    const std::vector<std::string>& getOpenedLibraries () const;
+
+    private:
+    LuaLibraryProfile profile = LuaLibraryProfile::Full;
+    std::vector<std::string> opened_libraries;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <cstdlib>
 #include <string>
 #include <iostream>
+#include <chrono>
 #include <optional>
 #include <filesystem>
 
@@ -22,6 +23,10 @@
 #include "./mutil.hpp"
 #include "./window.hpp"
 #include "./uidisplay.hpp"
+#include "./hashing.hpp"
+#include "./eventloop.hpp"
+#include "./startupprofile.hpp"
+#include "./fileprimer.hpp"
 
 using namespace HerixLib;
 
@@ -29,6 +34,9 @@ std::filesystem::path findConfigurationFile (cxxopts::ParseResult& result);
 std::filesystem::path findPluginsDirectory (cxxopts::ParseResult& result, int argc, char** argv);
 void setupCurses ();
 void shutdownCurses ();
+int runHash (const std::filesystem::path& filename, const std::string& algorithm_name, std::pair<AbsoluteFilePosition, std::optional<AbsoluteFilePosition>> file_range);
+
+void reportStartupProfile (cxxopts::ParseResult& result);
 
 int main (int argc, char** argv) {
     cxxopts::Options options("HerixTUI", "Terminal Hex Editor");
@@ -42,10 +50,19 @@ int main (int argc, char** argv) {
         ("s,start", "The start position in the file, restricts editing to after this.", cxxopts::value<std::string>())
         ("e,end", "The end position in the file, restricts editing to before this.", cxxopts::value<std::string>())
         ("d,debug", "Turn on debug mode.")
+        ("diff", "Compare the file against this one, shown side by side. n/N jump between differences.", cxxopts::value<std::string>())
+        ("hash", "Print the hash of the file (within start/end) and exit. One of: crc32, crc32c, sha1, sha256, xxh64", cxxopts::value<std::string>())
+        ("hash_portable", "Don't use CPU extensions when hashing, for comparing speeds.")
+        ("profile_startup", "Time each phase of starting up. Printed on exit, or written as JSON to the given file.", cxxopts::value<std::string>()->implicit_value(""))
         ;
 
     cxxopts::ParseResult result = options.parse(argc, argv);
 
+    // As early as possible, so the report covers everything before the first frame
+    if (result.count("profile_startup") != 0) {
+        getStartupProfile().start();
+    }
+
     bool debug_mode = false;
 
     if (result.count("debug")) {
@@ -120,6 +137,31 @@ int main (int argc, char** argv) {
         }
     }
 
+    if (result.count("hash") != 0) {
+        if (result.count("hash_portable") != 0) {
+            setHashAcceleration(false);
+        }
+        return runHash(filename, result["hash"].as<std::string>(), std::make_pair(start_position, end_position));
+    }
+
+    // Before anything starts a thread, so that resizes are only seen by the event loop
+    EventLoop::blockSignals();
+
+    // Reads the start of the file while curses, lua and the config are being set up
+    FilePrimer primer(filename, std::make_pair(start_position, end_position));
+
+    std::optional<std::filesystem::path> diff_filename = std::nullopt;
+    if (result.count("diff") > 1) {
+        std::cout << "Only one file can be compared against.\n";
+        return 1;
+    } else if (result.count("diff") == 1) {
+        diff_filename = result["diff"].as<std::string>();
+        if (!std::filesystem::is_regular_file(diff_filename.value())) {
+            std::cout << "The file to compare against does not exist.\n";
+            return 1;
+        }
+    }
+
     std::cout << "S: " << start_position << "\n";
     std::cout << "E: ";
     if (end_position.has_value()) {
@@ -129,24 +171,44 @@ int main (int argc, char** argv) {
     }
     std::cout << "\n";
 
-    setupCurses();
+    {
+        StartupPhase phase("curses");
+        setupCurses();
+    }
     try {
-        UIDisplay display = UIDisplay(filename, config_file, plugin_dir, allow_writing, std::make_pair(start_position, end_position), debug_mode);
+        UIDisplay display = UIDisplay(filename, config_file, plugin_dir, allow_writing, std::make_pair(start_position, end_position), debug_mode, diff_filename, &primer);
 
         refresh();
 
         // This could be done in the UIDisplay constructor, but I find it more palatable to do it explicitly.
         display.handleInit();
+        reportStartupProfile(result);
+
+        // Keys are only read once poll says there are some, so getch never blocks
+        timeout(0);
+        while (!display.should_exit) {
+            EventLoop::WaitResult woken = display.events.wait(display.getIdleTimeout());
+
+            if (woken.resized) {
+                display.handleResize();
+            }
+
+            if (woken.input) {
+                // Curses may have read more than one key at once, which poll won't report again
+                while (!display.should_exit && (display.key = getch()) != ERR) {
+                    display.handleEvent();
+                }
+            }
 
-        while (true) {
-            display.key = getch();
-            display.handleEvent();
+            // Jobs posted by workers, and timers which are due
+            display.events.dispatch();
 
-            if (display.should_exit) {
-                break;
+            if (!woken.input && !display.should_exit) {
+                display.handleIdle();
             }
         }
 
+        display.reportFrameTimes();
         shutdownCurses();
 
         printExitLogs();
@@ -159,6 +221,52 @@ int main (int argc, char** argv) {
     return 0;
 }
 
+void reportStartupProfile (cxxopts::ParseResult& result) {
+    StartupProfile& profile = getStartupProfile();
+    if (!profile.isEnabled()) {
+        return;
+    }
+    profile.finish();
+
+    std::string json_path = result["profile_startup"].as<std::string>();
+    if (json_path.empty()) {
+        for (const std::string& line : profile.getReport()) {
+            logAtExit(line);
+        }
+        return;
+    }
+
+    try {
+        profile.writeJSON(json_path);
+    } catch (const std::runtime_error& err) {
+        logAtExit(err.what());
+    }
+}
+
+// Hashes without starting up the interface, printed like sha256sum would so the two can be compared.
+// The throughput goes to stderr.
+int runHash (const std::filesystem::path& filename, const std::string& algorithm_name, std::pair<AbsoluteFilePosition, std::optional<AbsoluteFilePosition>> file_range) {
+    std::optional<HashAlgorithm> algorithm = parseHashAlgorithm(algorithm_name);
+    if (!algorithm.has_value()) {
+        std::cout << "Unknown hash algorithm '" << algorithm_name << "'.\n";
+        return 1;
+    }
+
+    // Large chunks, since everything is read exactly once
+    EditLayer hex(filename, false, file_range, 1024 * 1024 * 8, 1024 * 1024);
+    size_t length = hex.getFileEnd();
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::string digest = hashRange(hex, algorithm.value(), 0, length);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << digest << "  " << filename.string() << "\n";
+    std::cerr << getHashAlgorithmName(algorithm.value()) << " (" << getHashImplementation(algorithm.value()) << "): " <<
+        length << " bytes in " << elapsed.count() << "s, " <<
+        (static_cast<double>(length) / (1024.0 * 1024.0)) / std::max(elapsed.count(), 1e-9) << " MiB/s\n";
+    return 0;
+}
+
 void setupCurses () {
     initscr();
     clear();
@@ -167,6 +275,8 @@ void setupCurses () {
     keypad(stdscr, true);
     curs_set(0);
     start_color();
+    // Only clicks are used, for jumping with the minimap
+    mousemask(BUTTON1_PRESSED | BUTTON1_CLICKED, nullptr);
 
     // Generated by script, ofc I wouldn't write this by hand.
     // Also the enum declaration (for MColors) and the lua setting was also generated via script.
@@ -0,0 +1,84 @@
+#include "./minimapview.hpp"
+
+namespace {
+    struct MinimapCell {
+        char glyph;
+        MColors color;
+    };
+
+    MinimapCell classify (const BlockSummary& block) {
+        if (!block.ready) {
+            // Not computed yet
+            return MinimapCell{'.', MColors::DEFAULT};
+        } else if (block.zeroes >= 243) { // ~95% zeroes
+            return MinimapCell{' ', MColors::DEFAULT};
+        } else if (block.printable >= 191) { // ~75% printable
+            return MinimapCell{'T', MColors::GREEN_BLACK};
+        } else if (block.entropy >= 240) { // 7.5 bits, compressed/encrypted
+            return MinimapCell{'#', MColors::RED_BLACK};
+        } else if (block.entropy >= 160) { // 5 bits
+            return MinimapCell{'=', MColors::YELLOW_BLACK};
+        } else {
+            return MinimapCell{'-', MColors::CYAN_BLACK};
+        }
+    }
+}
+
+MinimapView::MinimapView (size_t t_sub_view_id) : sub_view_id(t_sub_view_id) {}
+
+std::pair<HerixLib::FilePosition, HerixLib::FilePosition> MinimapView::getWindow (const FileSummary& summary, HerixLib::FilePosition view_start, size_t height) const {
+    const size_t file_end = summary.getFileEnd();
+    size_t length = std::max(file_end >> zoom, std::min(height, file_end));
+
+    // Centered on the view, but kept inside the file
+    HerixLib::FilePosition start = view_start > length / 2 ? view_start - length / 2 : 0;
+    start = std::min(start, file_end - length);
+    return std::make_pair(start, start + length);
+}
+
+HerixLib::FilePosition MinimapView::getRowStart (const FileSummary& summary, HerixLib::FilePosition view_start, size_t height, size_t row) const {
+    auto [start, end] = getWindow(summary, view_start, height);
+    if (height == 0) {
+        return start;
+    }
+    // Multiplying first keeps small windows spread over every row.
+    return start + (row * (end - start)) / height;
+}
+
+void MinimapView::zoomIn (const FileSummary& summary, size_t height) {
+    if ((summary.getFileEnd() >> (zoom + 1)) >= height * summary.getBlockSize()) {
+        zoom++;
+    }
+}
+void MinimapView::zoomOut () {
+    if (zoom > 0) {
+        zoom--;
+    }
+}
+
+void MinimapView::render (SubView& sub_view, ViewWindow& view, const FileSummary& summary, HerixLib::FilePosition view_start, HerixLib::FilePosition view_end) const {
+    const size_t height = static_cast<size_t>(std::max(sub_view.getHeight(), 0));
+    const size_t width = static_cast<size_t>(std::max(sub_view.getWidth(), 0));
+    if (height == 0 || width == 0 || summary.getFileEnd() == 0) {
+        return;
+    }
+
+    for (size_t row = 0; row < height; row++) {
+        HerixLib::FilePosition row_start = getRowStart(summary, view_start, height, row);
+        HerixLib::FilePosition row_end = std::max(getRowStart(summary, view_start, height, row + 1), row_start + 1);
+
+        MinimapCell cell = classify(summary.summarizeRange(row_start, row_end));
+        bool in_view = row_start < view_end && view_start < row_end;
+
+        sub_view.move(0, static_cast<int>(row));
+        if (in_view) {
+            wattron(view.win, A_STANDOUT);
+        }
+        view.enableColor(cell.color);
+        sub_view.print(std::string(width, cell.glyph));
+        view.disableColor(cell.color);
+        if (in_view) {
+            wattroff(view.win, A_STANDOUT);
+        }
+    }
+}
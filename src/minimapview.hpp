@@ -0,0 +1,33 @@
+#ifndef FILE_SEEN_MINIMAPVIEW
+#define FILE_SEEN_MINIMAPVIEW
+
+#include <utility>
+#include "./subview.hpp"
+#include "./filesummary.hpp"
+
+// An overview column of the file, each row showing what kind of data the bytes it covers are.
+// It can be zoomed in, in which case it shows a window of the file around what the hex view is at.
+class MinimapView {
+    public:
+    size_t sub_view_id;
+    // Each step halves how much of the file is shown, 0 shows all of it.
+    size_t zoom = 0;
+    // Whether keys go to the minimap
+    bool focused = false;
+
+    explicit MinimapView (size_t t_sub_view_id);
+
+    // The range of the file being shown, for a view of `height` rows.
+    std::pair<HerixLib::FilePosition, HerixLib::FilePosition> getWindow (const FileSummary& summary, HerixLib::FilePosition view_start, size_t height) const;
+    // The start of the bytes that row covers
+    HerixLib::FilePosition getRowStart (const FileSummary& summary, HerixLib::FilePosition view_start, size_t height, size_t row) const;
+
+    // Stops once each row would be a single block, since there is nothing finer to show.
+    void zoomIn (const FileSummary& summary, size_t height);
+    void zoomOut ();
+
+    // Only looks at a constant amount of summary entries per row, so it is O(height) at any zoom.
+    void render (SubView& sub_view, ViewWindow& view, const FileSummary& summary, HerixLib::FilePosition view_start, HerixLib::FilePosition view_end) const;
+};
+
+#endif
@@ -61,6 +61,32 @@ std::optional<std::filesystem::path> getPluginsPath(int argc, char** argv) {
     return std::nullopt;
 }
 
+std::optional<std::filesystem::path> getStateDirectory () {
+    char* xdg_state_home = std::getenv("XDG_STATE_HOME");
+    if (xdg_state_home != nullptr && xdg_state_home[0] != '\0') {
+        return std::filesystem::path(xdg_state_home) / "herixtui";
+    }
+
+    char* home = std::getenv("HOME");
+    if (home != nullptr) {
+        return std::filesystem::path(home) / ".local/state/herixtui";
+    }
+    return std::nullopt;
+}
+
+std::optional<std::filesystem::path> getCacheDirectory () {
+    char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+    if (xdg_cache_home != nullptr && xdg_cache_home[0] != '\0') {
+        return std::filesystem::path(xdg_cache_home) / "herixtui";
+    }
+
+    char* home = std::getenv("HOME");
+    if (home != nullptr) {
+        return std::filesystem::path(home) / ".cache/herixtui";
+    }
+    return std::nullopt;
+}
+
 // Returns whether the string is all whitespace. Returns true if string is empty.
 bool isStringWhitespace (const std::string& str) {
     for (char val : str) {
@@ -94,6 +120,19 @@ std::string byteToStringPadded (HerixLib::Byte byte) {
 	res += hexChr(byte % 16);
 	return res;
 }
+// Pads with zeroes up to min_width
+std::string numberToHex (size_t value, size_t min_width) {
+    std::string res = "";
+    do {
+        res.insert(res.begin(), hexChr(static_cast<HerixLib::Byte>(value % 16)));
+        value /= 16;
+    } while (value != 0);
+
+    if (res.size() < min_width) {
+        res.insert(0, min_width - res.size(), '0');
+    }
+    return res;
+}
 // Without padding before byte
 std::string byteToString (HerixLib::Byte byte) {
     std::string res = "";
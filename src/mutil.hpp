@@ -4,6 +4,8 @@
 #include <optional>
 #include <filesystem>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include "./Herix/src/herix.hpp"
 
 enum class MColors {
@@ -88,12 +90,15 @@ enum class UIBarAsking {
     Message,
     ShouldExit,
     ShouldSave,
+    // Typing a command into the bar, such as ":goto 0x1000"
+    Command,
 };
 enum class UIState {
     Default,
     Hex,
     InfoAsking,
     Info,
+    Strings,
 };
 enum class HexViewState {
     Default,
@@ -126,9 +131,14 @@ struct KeyHandleFlags {
 std::string getFilename(int argc, char** argv);
 std::optional<std::filesystem::path> getConfigPath ();
 std::optional<std::filesystem::path> getPluginsPath (int argc, char** argv);
+// $XDG_STATE_HOME/herixtui, or ~/.local/state/herixtui. Not created, and nullopt if neither variable is set.
+std::optional<std::filesystem::path> getStateDirectory ();
+// $XDG_CACHE_HOME/herixtui, or ~/.cache/herixtui. Not created, and nullopt if neither variable is set.
+std::optional<std::filesystem::path> getCacheDirectory ();
 bool isStringWhitespace (const std::string& str);
 std::string byteToString (HerixLib::Byte byte);
 std::string byteToStringPadded (HerixLib::Byte byte);
+std::string numberToHex (size_t value, size_t min_width);
 char hexChr (HerixLib::Byte v);
 HerixLib::Byte hexChrToNumber (char c);
 template<typename T>
@@ -152,6 +162,20 @@ T decToNumber (const std::string& str) {
     }
     return acc;
 }
+// Reads [start, start + length) through Herix (or the EditLayer on top of it) in pieces of at most chunk_size
+// bytes, handing each one to func(const HerixLib::Byte* data, size_t size) in order. Stops early if the file ends first.
+template<typename Source, typename F>
+void streamRange (Source& hex, HerixLib::FilePosition start, size_t length, size_t chunk_size, F func) {
+    while (length > 0) {
+        std::vector<HerixLib::Byte> data = hex.readMultipleCutoff(start, std::min(length, chunk_size));
+        if (data.empty()) {
+            break;
+        }
+        func(data.data(), data.size());
+        start += data.size();
+        length -= data.size();
+    }
+}
 bool isHexadecimalCharacter (int c);
 bool isHexadecimalCharacter (char c);
 HerixLib::Byte clearHighestHalfByte (HerixLib::Byte val);
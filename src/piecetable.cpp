@@ -0,0 +1,157 @@
+#include "./piecetable.hpp"
+
+#include <algorithm>
+
+PieceTable::PieceTable (size_t original_length) {
+    if (original_length != 0) {
+        root = createNode(Piece{PieceSource::Original, 0, original_length});
+    }
+}
+
+size_t PieceTable::getLength () const {
+    return getTotal(root);
+}
+size_t PieceTable::getPieceCount () const {
+    return nodes.size() - free_nodes.size();
+}
+
+Piece PieceTable::find (HerixLib::FilePosition pos) const {
+    NodeIndex node = root;
+    HerixLib::FilePosition node_start = 0;
+    while (node != NO_NODE) {
+        const Node& n = nodes[static_cast<size_t>(node)];
+        HerixLib::FilePosition piece_start = node_start + getTotal(n.left);
+        if (pos < piece_start) {
+            node = n.left;
+        } else if (pos >= piece_start + n.piece.length) {
+            node_start = piece_start + n.piece.length;
+            node = n.right;
+        } else {
+            Piece cut = n.piece;
+            cut.offset += pos - piece_start;
+            cut.length -= pos - piece_start;
+            return cut;
+        }
+    }
+    return Piece{PieceSource::Original, 0, 0};
+}
+
+std::vector<Piece> PieceTable::replace (HerixLib::FilePosition pos, size_t length, const std::vector<Piece>& pieces) {
+    NodeIndex before = NO_NODE;
+    NodeIndex middle = NO_NODE;
+    NodeIndex after = NO_NODE;
+    split(root, pos, before, middle);
+    split(middle, length, middle, after);
+
+    std::vector<Piece> removed;
+    freeTree(middle, removed);
+
+    NodeIndex inserted = NO_NODE;
+    for (const Piece& piece : pieces) {
+        if (piece.length != 0) {
+            inserted = merge(inserted, createNode(piece));
+        }
+    }
+
+    root = merge(merge(before, inserted), after);
+    return removed;
+}
+
+PieceTable::NodeIndex PieceTable::createNode (const Piece& piece) {
+    // xorshift, the priorities only need to be spread out
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    Node node;
+    node.piece = piece;
+    node.total = piece.length;
+    node.priority = random_state;
+
+    if (!free_nodes.empty()) {
+        NodeIndex index = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[static_cast<size_t>(index)] = node;
+        return index;
+    }
+    nodes.push_back(node);
+    return static_cast<NodeIndex>(nodes.size() - 1);
+}
+
+void PieceTable::freeTree (NodeIndex node, std::vector<Piece>& out) {
+    if (node == NO_NODE) {
+        return;
+    }
+    freeTree(nodes[static_cast<size_t>(node)].left, out);
+    out.push_back(nodes[static_cast<size_t>(node)].piece);
+    freeTree(nodes[static_cast<size_t>(node)].right, out);
+    free_nodes.push_back(node);
+}
+
+size_t PieceTable::getTotal (NodeIndex node) const {
+    return node == NO_NODE ? 0 : nodes[static_cast<size_t>(node)].total;
+}
+
+void PieceTable::updateTotal (NodeIndex node) {
+    Node& n = nodes[static_cast<size_t>(node)];
+    n.total = getTotal(n.left) + n.piece.length + getTotal(n.right);
+}
+
+void PieceTable::split (NodeIndex node, size_t pos, NodeIndex& left, NodeIndex& right) {
+    if (node == NO_NODE) {
+        left = NO_NODE;
+        right = NO_NODE;
+        return;
+    }
+
+    const size_t left_total = getTotal(nodes[static_cast<size_t>(node)].left);
+    const size_t piece_length = nodes[static_cast<size_t>(node)].piece.length;
+    if (pos <= left_total) {
+        NodeIndex child_right = NO_NODE;
+        split(nodes[static_cast<size_t>(node)].left, pos, left, child_right);
+        nodes[static_cast<size_t>(node)].left = child_right;
+        updateTotal(node);
+        right = node;
+    } else if (pos >= left_total + piece_length) {
+        NodeIndex child_left = NO_NODE;
+        split(nodes[static_cast<size_t>(node)].right, pos - left_total - piece_length, child_left, right);
+        nodes[static_cast<size_t>(node)].right = child_left;
+        updateTotal(node);
+        left = node;
+    } else {
+        // Inside of this piece: it keeps the first part, and the rest becomes a new node in front of the right side
+        size_t cut = pos - left_total;
+        Piece rest = nodes[static_cast<size_t>(node)].piece;
+        rest.offset += cut;
+        rest.length -= cut;
+        NodeIndex rest_node = createNode(rest);
+
+        NodeIndex old_right = nodes[static_cast<size_t>(node)].right;
+        nodes[static_cast<size_t>(node)].right = NO_NODE;
+        nodes[static_cast<size_t>(node)].piece.length = cut;
+        updateTotal(node);
+
+        left = node;
+        right = merge(rest_node, old_right);
+    }
+}
+
+PieceTable::NodeIndex PieceTable::merge (NodeIndex left, NodeIndex right) {
+    if (left == NO_NODE) {
+        return right;
+    } else if (right == NO_NODE) {
+        return left;
+    }
+
+    if (nodes[static_cast<size_t>(left)].priority > nodes[static_cast<size_t>(right)].priority) {
+        NodeIndex merged = merge(nodes[static_cast<size_t>(left)].right, right);
+        nodes[static_cast<size_t>(left)].right = merged;
+        updateTotal(left);
+        return left;
+    } else {
+        NodeIndex merged = merge(left, nodes[static_cast<size_t>(right)].left);
+        nodes[static_cast<size_t>(right)].left = merged;
+        updateTotal(right);
+        return right;
+    }
+}
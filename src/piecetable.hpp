@@ -0,0 +1,103 @@
+#ifndef FILE_SEEN_PIECETABLE
+#define FILE_SEEN_PIECETABLE
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "./Herix/src/herix.hpp"
+
+enum class PieceSource : uint8_t {
+    // The file as it was opened
+    Original,
+    // Bytes which were inserted, kept in an append-only buffer
+    Added,
+};
+
+struct Piece {
+    PieceSource source = PieceSource::Original;
+    // Where in the source the bytes start
+    uint64_t offset = 0;
+    size_t length = 0;
+};
+
+// The layout of the file as a sequence of pieces, each a stretch of either the original file or of inserted bytes.
+// Stored as a treap keyed implicitly by position, where every node knows the total length under it, so finding
+// the piece at a position, and replacing a range, are O(log n) in the amount of pieces.
+// Nodes are kept in a vector and refer to each other by index, to avoid an allocation per piece.
+class PieceTable {
+    public:
+    explicit PieceTable (size_t original_length = 0);
+
+    size_t getLength () const;
+    size_t getPieceCount () const;
+
+    // Calls func(const Piece& piece, HerixLib::FilePosition position) for every piece overlapping
+    // [pos, pos + length), in order, with the pieces cut down to the range.
+    template<typename F>
+    void forEachPiece (HerixLib::FilePosition pos, size_t length, F func) const {
+        if (length != 0) {
+            visit(root, 0, pos, pos + length, func);
+        }
+    }
+
+    // The piece holding the byte at pos, cut to start at it. Has a length of 0 if pos is past the end.
+    Piece find (HerixLib::FilePosition pos) const;
+
+    // Replaces [pos, pos + length) with the pieces, returning the pieces that were there.
+    std::vector<Piece> replace (HerixLib::FilePosition pos, size_t length, const std::vector<Piece>& pieces);
+
+    private:
+    using NodeIndex = int32_t;
+    static constexpr NodeIndex NO_NODE = -1;
+
+    struct Node {
+        Piece piece;
+        // Length of every piece in this subtree
+        size_t total = 0;
+        uint32_t priority = 0;
+        NodeIndex left = NO_NODE;
+        NodeIndex right = NO_NODE;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<NodeIndex> free_nodes;
+    NodeIndex root = NO_NODE;
+    uint32_t random_state = 0x9E3779B9;
+
+    NodeIndex createNode (const Piece& piece);
+    void freeTree (NodeIndex node, std::vector<Piece>& out);
+    size_t getTotal (NodeIndex node) const;
+    void updateTotal (NodeIndex node);
+    // Splits so that left gets the first pos bytes, cutting a piece in two if needed.
+    void split (NodeIndex node, size_t pos, NodeIndex& left, NodeIndex& right);
+    NodeIndex merge (NodeIndex left, NodeIndex right);
+
+    template<typename F>
+    void visit (NodeIndex node, HerixLib::FilePosition node_start, HerixLib::FilePosition start, HerixLib::FilePosition end, F& func) const {
+        while (node != NO_NODE) {
+            const Node& n = nodes[static_cast<size_t>(node)];
+            HerixLib::FilePosition piece_start = node_start + getTotal(n.left);
+            HerixLib::FilePosition piece_end = piece_start + n.piece.length;
+
+            if (start < piece_start) {
+                visit(n.left, node_start, start, end, func);
+            }
+            if (start < piece_end && end > piece_start) {
+                HerixLib::FilePosition cut_start = std::max(start, piece_start);
+                HerixLib::FilePosition cut_end = std::min(end, piece_end);
+                Piece cut = n.piece;
+                cut.offset += cut_start - piece_start;
+                cut.length = cut_end - cut_start;
+                func(static_cast<const Piece&>(cut), cut_start);
+            }
+            if (end <= piece_end) {
+                return;
+            }
+            // The right side as a loop, since it's the one which gets long when reading forward
+            node_start = piece_end;
+            node = n.right;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "./recordindex.hpp"
+
+#include <algorithm>
+
+void RecordIndex::add (size_t index, HerixLib::FilePosition start, HerixLib::FilePosition end) {
+    if (start >= end) {
+        return;
+    }
+    size_t group = getGroup(start, end);
+    groups[group].emplace(start, Span{end, index});
+    used_groups |= uint64_t(1) << group;
+}
+
+void RecordIndex::remove (size_t index, HerixLib::FilePosition start, HerixLib::FilePosition end) {
+    if (start >= end) {
+        return;
+    }
+    size_t group = getGroup(start, end);
+    auto [first, last] = groups[group].equal_range(start);
+    for (auto it = first; it != last; ++it) {
+        if (it->second.index == index) {
+            groups[group].erase(it);
+            break;
+        }
+    }
+    if (groups[group].empty()) {
+        used_groups &= ~(uint64_t(1) << group);
+    }
+}
+
+void RecordIndex::clear () {
+    for (auto& group : groups) {
+        group.clear();
+    }
+    used_groups = 0;
+}
+
+void RecordIndex::find (HerixLib::FilePosition start, HerixLib::FilePosition end, std::vector<size_t>& out) const {
+    out.clear();
+    if (start >= end) {
+        return;
+    }
+
+    for (size_t g = 0; g < GROUP_COUNT; g++) {
+        if ((used_groups & (uint64_t(1) << g)) == 0) {
+            continue;
+        }
+        // The longest a span in this group can be is 2^(g+1) - 1, so it can't start any earlier than this and
+        // still reach start
+        const HerixLib::FilePosition reach = g + 1 < GROUP_COUNT ? (uint64_t(1) << (g + 1)) - 1 : UINT64_MAX;
+        const HerixLib::FilePosition from = start - std::min(start, reach - 1);
+        for (auto it = groups[g].lower_bound(from); it != groups[g].end() && it->first < end; ++it) {
+            if (it->second.end > start) {
+                out.push_back(it->second.index);
+            }
+        }
+    }
+    std::sort(out.begin(), out.end());
+}
+
+size_t RecordIndex::getGroup (HerixLib::FilePosition start, HerixLib::FilePosition end) {
+    // Position of the highest set bit of the length
+    uint64_t length = end - start;
+    size_t group = 0;
+    while (length > 1) {
+        length >>= 1;
+        group++;
+    }
+    return group;
+}
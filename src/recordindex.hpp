@@ -0,0 +1,42 @@
+#ifndef FILE_SEEN_RECORDINDEX
+#define FILE_SEEN_RECORDINDEX
+
+#include <map>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "./Herix/src/herix.hpp"
+
+// Which of the applied records cover which part of source space, so that a read only looks at the records which
+// overlap it rather than at every one. A record is kept by its span, from the start of its first run to the end of
+// its last.
+// Spans are grouped by the power of two under which their length falls. A span in group g is shorter than 2^(g+1),
+// so one overlapping a range has to start less than that before it, which bounds where to look in each group
+// without needing a tree that knows the furthest end under each node.
+class RecordIndex {
+    public:
+    void add (size_t index, HerixLib::FilePosition start, HerixLib::FilePosition end);
+    // Takes the same span the record was added with
+    void remove (size_t index, HerixLib::FilePosition start, HerixLib::FilePosition end);
+    void clear ();
+
+    // Replaces out with the indices of the records whose span overlaps [start, end), sorted, so they can be applied
+    // oldest first.
+    void find (HerixLib::FilePosition start, HerixLib::FilePosition end, std::vector<size_t>& out) const;
+
+    private:
+    struct Span {
+        HerixLib::FilePosition end;
+        size_t index;
+    };
+    static constexpr size_t GROUP_COUNT = 64;
+
+    // Keyed by the start of the span
+    std::array<std::multimap<HerixLib::FilePosition, Span>, GROUP_COUNT> groups;
+    // Bit g is set while groups[g] isn't empty, so a lookup skips the empty ones
+    uint64_t used_groups = 0;
+
+    static size_t getGroup (HerixLib::FilePosition start, HerixLib::FilePosition end);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "./scriptcache.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./hashing.hpp"
+
+namespace {
+    // Bytecode only loads into the same version of lua it was made by, so the version is part of the header
+#ifdef LUAJIT_VERSION
+    constexpr const char* LUA_IMPLEMENTATION = LUAJIT_VERSION;
+#else
+    constexpr const char* LUA_IMPLEMENTATION = LUA_RELEASE;
+#endif
+
+    bool writeAll (int fd, const void* data, size_t length) {
+        auto* bytes = static_cast<const char*>(data);
+        while (length > 0) {
+            ssize_t written = ::write(fd, bytes, length);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            } else if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+ScriptCache::ScriptCache (std::optional<std::filesystem::path> t_directory) : directory(std::move(t_directory)) {}
+
+sol::load_result ScriptCache::load (sol::state& lua, const std::filesystem::path& path) {
+    std::optional<SourceInfo> info = directory.has_value() ? getSourceInfo(path) : std::nullopt;
+    if (!info.has_value()) {
+        return lua.load_file(path.string());
+    }
+
+    const std::filesystem::path entry_path = getEntryPath(path);
+    const std::string header = makeHeader(path, info.value());
+    // Same name as load_file gives it, so errors point at the source file either way
+    const std::string chunk_name = "@" + path.string();
+
+    int fd = ::open(entry_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct stat entry_stat;
+        if (fstat(fd, &entry_stat) == 0 && static_cast<size_t>(entry_stat.st_size) > header.size()) {
+            size_t entry_size = static_cast<size_t>(entry_stat.st_size);
+            void* map = mmap(nullptr, entry_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                const char* data = static_cast<const char*>(map);
+                if (std::memcmp(data, header.data(), header.size()) == 0) {
+                    // Lua copies what it needs out of the buffer, so it can be unmapped right after
+                    sol::load_result loaded = lua.load_buffer(data + header.size(), entry_size - header.size(), chunk_name, sol::load_mode::binary);
+                    munmap(map, entry_size);
+                    ::close(fd);
+                    if (loaded.valid()) {
+                        hits++;
+                        return loaded;
+                    }
+                    // Otherwise it's compiled again below, which replaces the entry
+                    fd = -1;
+                } else {
+                    munmap(map, entry_size);
+                }
+            }
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    misses++;
+    sol::load_result loaded = lua.load_file(path.string());
+    if (loaded.valid()) {
+        try {
+            sol::protected_function chunk = loaded.get<sol::protected_function>();
+            store(entry_path, header, chunk.dump());
+        } catch (const sol::error&) {
+            // Some chunks can't be dumped, they're just not cached
+        }
+    }
+    return loaded;
+}
+
+size_t ScriptCache::getHits () const {
+    return hits;
+}
+size_t ScriptCache::getMisses () const {
+    return misses;
+}
+
+std::filesystem::path ScriptCache::getEntryPath (const std::filesystem::path& path) const {
+    std::string key = path.string();
+    Hasher hasher(HashAlgorithm::XXH64);
+    hasher.update(reinterpret_cast<const HerixLib::Byte*>(key.data()), key.size());
+    return directory.value() / (hasher.finish() + ".luac");
+}
+
+std::string ScriptCache::makeHeader (const std::filesystem::path& path, const SourceInfo& info) {
+    // The path is included so that two files with the same hash can't be mixed up
+    return std::string("HERIXLBC\n") + LUA_IMPLEMENTATION + "\n" + std::to_string(info.mtime_ns) + "\n" +
+        std::to_string(info.size) + "\n" + path.string() + "\n";
+}
+
+std::optional<ScriptCache::SourceInfo> ScriptCache::getSourceInfo (const std::filesystem::path& path) {
+    struct stat source_stat;
+    if (stat(path.c_str(), &source_stat) != 0) {
+        return std::nullopt;
+    }
+    return SourceInfo{
+        static_cast<int64_t>(source_stat.st_mtim.tv_sec) * 1000000000 + static_cast<int64_t>(source_stat.st_mtim.tv_nsec),
+        static_cast<uint64_t>(source_stat.st_size)
+    };
+}
+
+void ScriptCache::store (const std::filesystem::path& entry_path, const std::string& header, const sol::bytecode& code) {
+    std::error_code error;
+    std::filesystem::create_directories(entry_path.parent_path(), error);
+    if (error) {
+        return;
+    }
+
+    // Written to the side and renamed over, so another instance starting at the same time never sees half of it
+    std::filesystem::path temp_path = entry_path;
+    temp_path += "." + std::to_string(getpid()) + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    bool written = writeAll(fd, header.data(), header.size()) && writeAll(fd, code.data(), code.size());
+    ::close(fd);
+
+    if (!written || rename(temp_path.c_str(), entry_path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef FILE_SEEN_SCRIPTCACHE
+#define FILE_SEEN_SCRIPTCACHE
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weverything"
+
+#define SOL_ALL_SAFETIES_ON 1
+#include "./sol.hpp"
+
+#pragma GCC diagnostic pop
+
+#include <string>
+#include <cstddef>
+#include <optional>
+#include <filesystem>
+
+// Keeps the compiled form of lua files, so that they don't have to be parsed and compiled again on every start.
+// Each file's bytecode is stored in the directory under a hash of its path, along with the modification time and
+// size of the source it was compiled from; if either differs, or the bytecode doesn't load (such as after the lua
+// version changed), the source is compiled again and the cache entry replaced.
+// Nothing in it is required: if the cache can't be read or written, files are just loaded from source.
+class ScriptCache {
+    public:
+    // nullopt to never cache
+    explicit ScriptCache (std::optional<std::filesystem::path> t_directory = std::nullopt);
+
+    // Like lua.load_file, but through the cache
+    sol::load_result load (sol::state& lua, const std::filesystem::path& path);
+
+    // How many files were loaded from the cache/compiled from source, for logging
+    size_t getHits () const;
+    size_t getMisses () const;
+
+    private:
+    std::optional<std::filesystem::path> directory;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    struct SourceInfo {
+        int64_t mtime_ns;
+        uint64_t size;
+    };
+
+    std::filesystem::path getEntryPath (const std::filesystem::path& path) const;
+    // The header the entry for the file has to start with to be used
+    static std::string makeHeader (const std::filesystem::path& path, const SourceInfo& info);
+    static std::optional<SourceInfo> getSourceInfo (const std::filesystem::path& path);
+    void store (const std::filesystem::path& entry_path, const std::string& header, const sol::bytecode& code);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "./search.hpp"
+
+#include <algorithm>
+#include <functional>
+
+StreamingSearch::StreamingSearch (std::vector<HerixLib::Byte> t_needle, HerixLib::FilePosition t_start) :
+    needle(t_needle), position(t_start) {
+    done = needle.empty();
+}
+
+bool StreamingSearch::step (EditLayer& hex, size_t budget, std::vector<HerixLib::FilePosition>& out) {
+    if (done) {
+        return true;
+    }
+
+    const size_t file_end = hex.getFileEnd();
+    if (position >= file_end || file_end - position < needle.size()) {
+        position = file_end;
+        done = true;
+        return true;
+    }
+
+    // Matches have to start in [position, position + scan), but the read goes a bit past that so ones which
+    // cross into the next piece are still found here.
+    const size_t scan = std::min(std::max<size_t>(budget, 1), file_end - position);
+    std::vector<HerixLib::Byte> data = hex.readMultipleCutoff(position, scan + needle.size() - 1);
+
+    std::boyer_moore_horspool_searcher searcher(needle.begin(), needle.end());
+    HerixLib::FilePosition next = position + scan;
+    auto it = data.begin();
+    while (true) {
+        it = std::search(it, data.end(), searcher);
+        if (it == data.end() || static_cast<size_t>(it - data.begin()) >= scan) {
+            break;
+        }
+        HerixLib::FilePosition match = position + static_cast<size_t>(it - data.begin());
+        out.push_back(match);
+        next = std::max(next, match + needle.size());
+        it += static_cast<std::ptrdiff_t>(needle.size());
+    }
+
+    position = next;
+    return false;
+}
+
+bool StreamingSearch::isDone () const {
+    return done;
+}
+HerixLib::FilePosition StreamingSearch::getPosition () const {
+    return position;
+}
+const std::vector<HerixLib::Byte>& StreamingSearch::getNeedle () const {
+    return needle;
+}
@@ -0,0 +1,30 @@
+#ifndef FILE_SEEN_SEARCH
+#define FILE_SEEN_SEARCH
+
+#include <vector>
+#include <cstdint>
+#include "./editlayer.hpp"
+
+// Finds every occurrence of a byte string, a piece of the file at a time, so that going through a large file
+// can be spread over many calls without blocking the editor.
+// Matches don't overlap: after a match, searching continues from its end (like replacing them all would need).
+class StreamingSearch {
+    public:
+    StreamingSearch (std::vector<HerixLib::Byte> t_needle, HerixLib::FilePosition t_start = 0);
+
+    // Searches the next (up to) budget bytes, adding the positions of any matches to out, in order.
+    // Returns true once the end of the file has been reached.
+    bool step (EditLayer& hex, size_t budget, std::vector<HerixLib::FilePosition>& out);
+
+    bool isDone () const;
+    // Matches starting before this have all been found
+    HerixLib::FilePosition getPosition () const;
+    const std::vector<HerixLib::Byte>& getNeedle () const;
+
+    private:
+    std::vector<HerixLib::Byte> needle;
+    HerixLib::FilePosition position;
+    bool done = false;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "./spillfile.hpp"
+
+#include <cerrno>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+SpillFile::SpillFile () {}
+SpillFile::SpillFile (SpillFile&& other) noexcept : fd(std::exchange(other.fd, -1)), size(std::exchange(other.size, 0)) {}
+SpillFile& SpillFile::operator= (SpillFile&& other) noexcept {
+    if (this != &other) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        fd = std::exchange(other.fd, -1);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+SpillFile::~SpillFile () {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+uint64_t SpillFile::append (const HerixLib::Byte* data, size_t length) {
+    if (fd < 0) {
+        create();
+    }
+
+    const uint64_t offset = size;
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, static_cast<off_t>(size));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed writing edits to temporary file: ") + std::strerror(errno));
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        size += static_cast<uint64_t>(written);
+    }
+    return offset;
+}
+
+void SpillFile::read (uint64_t offset, HerixLib::Byte* out, size_t length) const {
+    while (length > 0) {
+        ssize_t amount = pread(fd, out, length, static_cast<off_t>(offset));
+        if (amount < 0 && errno == EINTR) {
+            continue;
+        } else if (amount <= 0) {
+            throw std::runtime_error(std::string("Failed reading edits from temporary file: ") +
+                (amount == 0 ? "unexpected end" : std::strerror(errno)));
+        }
+        out += amount;
+        length -= static_cast<size_t>(amount);
+        offset += static_cast<uint64_t>(amount);
+    }
+}
+
+uint64_t SpillFile::getSize () const {
+    return size;
+}
+
+void SpillFile::clear () {
+    if (fd >= 0 && size != 0) {
+        // If it fails the space is only wasted until it's closed
+        if (ftruncate(fd, 0) != 0) {}
+    }
+    size = 0;
+}
+
+void SpillFile::create () {
+    const char* tmp_env = std::getenv("TMPDIR");
+    std::string directory = (tmp_env != nullptr && tmp_env[0] != '\0') ? tmp_env : "/tmp";
+
+#ifdef O_TMPFILE
+    fd = ::open(directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        return;
+    }
+#endif
+
+    // Not every filesystem supports O_TMPFILE
+    std::string path = directory + "/herix-spill-XXXXXX";
+    fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not create temporary file for edits: ") + std::strerror(errno));
+    }
+    unlink(path.c_str());
+}
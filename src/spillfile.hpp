@@ -0,0 +1,34 @@
+#ifndef FILE_SEEN_SPILLFILE
+#define FILE_SEEN_SPILLFILE
+
+#include <cstdint>
+#include "./Herix/src/herix.hpp"
+
+// An anonymous temporary file which bytes can be moved into, to take them out of memory.
+// It's unlinked as soon as it's created (or created without a name at all, where supported), so it disappears
+// when closed, even if the editor crashes. Only created once something is first appended.
+// Throws std::runtime_error if creating/writing/reading fails.
+class SpillFile {
+    public:
+    SpillFile ();
+    SpillFile (const SpillFile&) = delete;
+    SpillFile& operator= (const SpillFile&) = delete;
+    SpillFile (SpillFile&& other) noexcept;
+    SpillFile& operator= (SpillFile&& other) noexcept;
+    ~SpillFile ();
+
+    // Returns the offset the bytes were put at
+    uint64_t append (const HerixLib::Byte* data, size_t size);
+    void read (uint64_t offset, HerixLib::Byte* out, size_t size) const;
+    uint64_t getSize () const;
+    // Throws away everything in it
+    void clear ();
+
+    private:
+    int fd = -1;
+    uint64_t size = 0;
+
+    void create ();
+};
+
+#endif
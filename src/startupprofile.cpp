@@ -0,0 +1,110 @@
+#include "./startupprofile.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <sys/resource.h>
+
+namespace {
+    std::string formatMilliseconds (double ms) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", ms);
+        return buffer;
+    }
+
+    std::string escapeJSON (const std::string& value) {
+        std::string result;
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(c));
+                result += buffer;
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+}
+
+void StartupProfile::start () {
+    enabled = true;
+    start_time = std::chrono::steady_clock::now();
+}
+
+bool StartupProfile::isEnabled () const {
+    return enabled;
+}
+
+void StartupProfile::record (std::string name, std::chrono::steady_clock::time_point phase_start, std::chrono::steady_clock::time_point phase_end) {
+    // Plugins loaded on a trigger later on aren't part of starting up
+    if (!enabled || finished) {
+        return;
+    }
+    phases.push_back(Phase{std::move(name), phase_start - start_time, phase_end - phase_start});
+}
+
+void StartupProfile::finish () {
+    if (enabled && !finished) {
+        total = std::chrono::steady_clock::now() - start_time;
+        finished = true;
+
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            max_rss_kb = usage.ru_maxrss;
+        }
+    }
+}
+
+std::vector<std::string> StartupProfile::getReport () const {
+    std::vector<Phase> sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [] (const Phase& a, const Phase& b) {
+        return a.duration > b.duration;
+    });
+
+    std::vector<std::string> lines;
+    lines.push_back("Startup: " + formatMilliseconds(total.count()) + "ms to the first frame, " + std::to_string(max_rss_kb) + "KiB peak RSS");
+    for (const Phase& phase : sorted) {
+        lines.push_back("  " + formatMilliseconds(phase.duration.count()) + "ms  " + phase.name +
+            " (at " + formatMilliseconds(phase.start.count()) + "ms)");
+    }
+    return lines;
+}
+
+void StartupProfile::writeJSON (const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not write the startup profile to '" + path.string() + "'.");
+    }
+
+    // Phases are recorded as they end, so an outer phase comes after its inner ones. Written in the order they
+    // started instead, which keeps the nesting readable.
+    std::vector<Phase> sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [] (const Phase& a, const Phase& b) {
+        return a.start < b.start;
+    });
+
+    file << "{\n  \"total_ms\": " << formatMilliseconds(total.count()) << ",\n  \"max_rss_kb\": " << max_rss_kb << ",\n  \"phases\": [";
+    for (size_t i = 0; i < sorted.size(); i++) {
+        file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << escapeJSON(sorted[i].name) << "\", \"start_ms\": " <<
+            formatMilliseconds(sorted[i].start.count()) << ", \"duration_ms\": " << formatMilliseconds(sorted[i].duration.count()) << "}";
+    }
+    file << "\n  ]\n}\n";
+}
+
+StartupProfile& getStartupProfile () {
+    static StartupProfile profile;
+    return profile;
+}
+
+StartupPhase::StartupPhase (std::string t_name) : name(std::move(t_name)), start_time(std::chrono::steady_clock::now()) {}
+
+StartupPhase::~StartupPhase () {
+    getStartupProfile().record(std::move(name), start_time, std::chrono::steady_clock::now());
+}
@@ -0,0 +1,60 @@
+#ifndef FILE_SEEN_STARTUPPROFILE
+#define FILE_SEEN_STARTUPPROFILE
+
+#include <string>
+#include <chrono>
+#include <vector>
+#include <filesystem>
+
+// Timings of each phase of starting up, for --profile_startup. Phases can be inside of each other (each plugin is
+// inside of loading the plugins), so they don't add up to the total.
+// Does nothing unless enabled, so the phases can be marked unconditionally.
+class StartupProfile {
+    public:
+    struct Phase {
+        std::string name;
+        // Since the profile was started
+        std::chrono::duration<double, std::milli> start;
+        std::chrono::duration<double, std::milli> duration;
+    };
+
+    // Starts the clock everything is measured from
+    void start ();
+    bool isEnabled () const;
+
+    void record (std::string name, std::chrono::steady_clock::time_point phase_start, std::chrono::steady_clock::time_point phase_end);
+    // Marks the end of starting up, the time to the first frame and the memory used by then. Nothing is recorded
+    // after it.
+    void finish ();
+
+    // Slowest phase first, a line each
+    std::vector<std::string> getReport () const;
+    // Throws std::runtime_error if the file can't be written
+    void writeJSON (const std::filesystem::path& path) const;
+
+    private:
+    bool enabled = false;
+    bool finished = false;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::duration<double, std::milli> total{0};
+    // Peak resident memory
+    long max_rss_kb = 0;
+    std::vector<Phase> phases;
+};
+
+StartupProfile& getStartupProfile ();
+
+// Records the time from its creation to its destruction as a phase of the startup profile
+class StartupPhase {
+    public:
+    explicit StartupPhase (std::string t_name);
+    StartupPhase (const StartupPhase&) = delete;
+    StartupPhase& operator= (const StartupPhase&) = delete;
+    ~StartupPhase ();
+
+    private:
+    std::string name;
+    std::chrono::steady_clock::time_point start_time;
+};
+
+#endif
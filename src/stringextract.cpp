@@ -0,0 +1,299 @@
+#include "./stringextract.hpp"
+
+#include <array>
+#include <optional>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+
+#include "./mutil.hpp"
+
+namespace {
+    // UTF-16LE is scanned at both even and odd offsets, like `strings -e l` would.
+    constexpr size_t STREAM_ASCII = 0;
+    constexpr size_t STREAM_UTF16LE_EVEN = 1;
+    constexpr size_t STREAM_UTF16LE_ODD = 2;
+
+    // Scans [0, limit) of data for runs of string characters which are `unit` bytes wide.
+    // `available` may go past `limit` so that a wide character starting on the last byte can still be checked.
+    // Runs shorter than min_bytes are dropped, unless they touch either end of the chunk, since they might
+    // continue into the neighbouring chunk. Those are filtered once stitched together.
+    void scanChunk (const HerixLib::Byte* data, size_t limit, size_t available, HerixLib::FilePosition base,
+        StringEncoding encoding, size_t parity, size_t min_bytes, std::vector<StringHit>& out) {
+        const size_t unit = encoding == StringEncoding::UTF16LE ? 2 : 1;
+        const size_t first = (unit == 1 || base % 2 == parity) ? 0 : 1;
+
+        // Where the current run started, only meaningful while in_run is set
+        size_t run_start = first;
+        bool in_run = false;
+        size_t i = first;
+        for (; i < limit; i += unit) {
+            bool is_character;
+            if (unit == 1) {
+                is_character = isStringCharacter(data[i]);
+            } else {
+                is_character = i + 1 < available && data[i + 1] == 0 && isStringCharacter(data[i]);
+            }
+
+            if (is_character) {
+                if (!in_run) {
+                    run_start = i;
+                    in_run = true;
+                }
+            } else if (in_run) {
+                size_t length = i - run_start;
+                if (length >= min_bytes || run_start == first) {
+                    out.push_back(StringHit{base + run_start, length, encoding});
+                }
+                in_run = false;
+            }
+        }
+
+        // Touches the end of the chunk, so always kept
+        if (in_run) {
+            out.push_back(StringHit{base + run_start, i - run_start, encoding});
+        }
+    }
+
+    // Joins runs which were split by a chunk boundary and drops the ones which end up too short.
+    void stitchHit (std::optional<StringHit>& pending, const StringHit& hit, size_t min_bytes, std::vector<StringHit>& out) {
+        if (pending.has_value()) {
+            StringHit& prev = pending.value();
+            if (prev.offset + prev.length == hit.offset) {
+                prev.length += hit.length;
+                return;
+            }
+
+            if (prev.length >= min_bytes) {
+                out.push_back(prev);
+            }
+        }
+        pending = hit;
+    }
+}
+
+bool isStringCharacter (HerixLib::Byte c) {
+    return isDisplayableCharacter(c) || c == '\t';
+}
+
+StringExtractor::StringExtractor (HerixLib::FilePosition t_start, HerixLib::FilePosition t_end, const StringExtractOptions& t_options) :
+    start(t_start), end(t_end), options(t_options), read_position(t_start) {
+    thread_count = options.threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Kept even so every chunk starts on the same alignment for wide characters.
+    chunk_size = std::max<size_t>(2, options.chunk_size - (options.chunk_size % 2));
+    min_bytes = {options.min_length, options.min_length * 2, options.min_length * 2};
+
+    if (start >= end || options.min_length == 0 || (!options.ascii && !options.utf16le)) {
+        read_finished = true;
+    }
+}
+
+bool StringExtractor::readBatch (EditLayer& hex, StringBatch& batch) {
+    if (read_finished || read_position >= end) {
+        read_finished = true;
+        return false;
+    }
+
+    batch.start = read_position;
+    batch.length = std::min(chunk_size * thread_count, end - read_position);
+    // One byte of lookahead, for a wide character that starts on the last byte of the batch
+    size_t lookahead = read_position + batch.length < end ? 1 : 0;
+    batch.data = hex.readMultipleCutoff(read_position, batch.length + lookahead);
+    if (batch.data.size() < batch.length) {
+        // Hit the end of the file early.
+        batch.length = batch.data.size();
+        read_finished = true;
+    }
+    if (batch.length == 0) {
+        read_finished = true;
+        return false;
+    }
+    read_position += batch.length;
+    return true;
+}
+
+void StringExtractor::scanBatch (const StringBatch& batch) {
+    using ChunkHits = std::array<std::vector<StringHit>, STREAM_COUNT>;
+
+    const size_t chunk_count = (batch.length + chunk_size - 1) / chunk_size;
+    std::vector<ChunkHits> chunk_hits(chunk_count);
+
+    auto worker = [&] (size_t first_chunk) {
+        for (size_t c = first_chunk; c < chunk_count; c += thread_count) {
+            size_t offset = c * chunk_size;
+            size_t limit = std::min(chunk_size, batch.length - offset);
+            size_t available = std::min(limit + 1, batch.data.size() - offset);
+            HerixLib::FilePosition base = batch.start + offset;
+
+            if (options.ascii) {
+                scanChunk(batch.data.data() + offset, limit, available, base, StringEncoding::ASCII, 0,
+                    min_bytes[STREAM_ASCII], chunk_hits[c][STREAM_ASCII]);
+            }
+            if (options.utf16le) {
+                scanChunk(batch.data.data() + offset, limit, available, base, StringEncoding::UTF16LE, 0,
+                    min_bytes[STREAM_UTF16LE_EVEN], chunk_hits[c][STREAM_UTF16LE_EVEN]);
+                scanChunk(batch.data.data() + offset, limit, available, base, StringEncoding::UTF16LE, 1,
+                    min_bytes[STREAM_UTF16LE_ODD], chunk_hits[c][STREAM_UTF16LE_ODD]);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < std::min<size_t>(thread_count, chunk_count); t++) {
+        workers.emplace_back(worker, t);
+    }
+    // This thread takes a share too rather than just waiting.
+    worker(0);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    for (ChunkHits& hits : chunk_hits) {
+        for (size_t s = 0; s < STREAM_COUNT; s++) {
+            for (const StringHit& hit : hits[s]) {
+                stitchHit(pending[s], hit, min_bytes[s], found[s]);
+            }
+        }
+    }
+}
+
+std::vector<StringHit> StringExtractor::finish () {
+    for (size_t s = 0; s < STREAM_COUNT; s++) {
+        if (pending[s].has_value() && pending[s].value().length >= min_bytes[s]) {
+            found[s].push_back(pending[s].value());
+        }
+        pending[s] = std::nullopt;
+    }
+
+    auto by_offset = [] (const StringHit& a, const StringHit& b) {
+        return a.offset < b.offset;
+    };
+    std::vector<StringHit> wide;
+    wide.reserve(found[STREAM_UTF16LE_EVEN].size() + found[STREAM_UTF16LE_ODD].size());
+    std::merge(found[STREAM_UTF16LE_EVEN].begin(), found[STREAM_UTF16LE_EVEN].end(),
+        found[STREAM_UTF16LE_ODD].begin(), found[STREAM_UTF16LE_ODD].end(), std::back_inserter(wide), by_offset);
+    found[STREAM_UTF16LE_EVEN] = std::vector<StringHit>();
+    found[STREAM_UTF16LE_ODD] = std::vector<StringHit>();
+
+    std::vector<StringHit> ret;
+    ret.reserve(found[STREAM_ASCII].size() + wide.size());
+    std::merge(found[STREAM_ASCII].begin(), found[STREAM_ASCII].end(), wide.begin(), wide.end(),
+        std::back_inserter(ret), by_offset);
+    found[STREAM_ASCII] = std::vector<StringHit>();
+    return ret;
+}
+
+HerixLib::FilePosition StringExtractor::getStart () const {
+    return start;
+}
+
+HerixLib::FilePosition StringExtractor::getEnd () const {
+    return end;
+}
+
+std::vector<StringHit> extractStrings (EditLayer& hex, HerixLib::FilePosition start, HerixLib::FilePosition end, const StringExtractOptions& options) {
+    StringExtractor extractor(start, end, options);
+    StringBatch batch;
+    while (extractor.readBatch(hex, batch)) {
+        extractor.scanBatch(batch);
+    }
+    return extractor.finish();
+}
+
+StringScanTask::StringScanTask (HerixLib::FilePosition start, HerixLib::FilePosition end, const StringExtractOptions& options,
+    std::function<void()> t_on_update) : extractor(start, end, options), on_update(std::move(t_on_update)) {
+    worker = std::thread(&StringScanTask::runWorker, this);
+}
+
+StringScanTask::~StringScanTask () {
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        worker_stop = true;
+    }
+    worker_wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool StringScanTask::update (EditLayer& hex) {
+    if (worker_done) {
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        // Only one batch is kept waiting, which bounds the memory to two batches
+        if (worker_queued.has_value() || worker_input_done) {
+            return false;
+        }
+    }
+
+    StringBatch batch;
+    bool has_batch = extractor.readBatch(hex, batch);
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex);
+        if (has_batch) {
+            worker_queued = std::move(batch);
+        } else {
+            worker_input_done = true;
+        }
+    }
+    worker_wake.notify_all();
+    return false;
+}
+
+bool StringScanTask::isDone () const {
+    return worker_done;
+}
+
+HerixLib::FilePosition StringScanTask::getProgress () const {
+    return worker_progress;
+}
+
+HerixLib::FilePosition StringScanTask::getSize () const {
+    return extractor.getEnd() - extractor.getStart();
+}
+
+std::vector<StringHit> StringScanTask::takeHits () {
+    if (!worker_done) {
+        return {};
+    }
+    return std::move(hits);
+}
+
+void StringScanTask::runWorker () {
+    while (true) {
+        StringBatch batch;
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex);
+            worker_wake.wait(lock, [this] {
+                return worker_stop || worker_queued.has_value() || worker_input_done;
+            });
+            if (worker_stop) {
+                return;
+            }
+            if (!worker_queued.has_value()) {
+                break;
+            }
+            batch = std::move(worker_queued.value());
+            worker_queued = std::nullopt;
+        }
+        // There's room for the next batch to be read while this one is scanned
+        if (on_update) {
+            on_update();
+        }
+
+        extractor.scanBatch(batch);
+        worker_progress = batch.start + batch.length - extractor.getStart();
+    }
+
+    hits = extractor.finish();
+    worker_done = true;
+    if (on_update) {
+        on_update();
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef FILE_SEEN_STRINGEXTRACT
+#define FILE_SEEN_STRINGEXTRACT
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <functional>
+#include <condition_variable>
+#include "./editlayer.hpp"
+
+enum class StringEncoding : uint8_t {
+    ASCII,
+    UTF16LE,
+};
+
+// A string found in the file. The text itself is not stored, it's read back when displayed.
+struct StringHit {
+    HerixLib::FilePosition offset;
+    // In bytes, so a UTF-16LE string of n characters has a length of 2n.
+    size_t length;
+    StringEncoding encoding;
+};
+
+struct StringExtractOptions {
+    // Minimum amount of characters for a run to be counted as a string.
+    size_t min_length = 4;
+    bool ascii = true;
+    bool utf16le = true;
+    // How many bytes each worker scans at a time.
+    size_t chunk_size = 1024 * 1024;
+    // 0 means to use however many threads the hardware has.
+    unsigned int threads = 0;
+};
+
+bool isStringCharacter (HerixLib::Byte c);
+
+// A batch of the range, as read for scanning. data can have one byte past length, for a wide character that starts
+// on its last byte.
+struct StringBatch {
+    HerixLib::FilePosition start = 0;
+    size_t length = 0;
+    std::vector<HerixLib::Byte> data;
+};
+
+// The steps of finding the strings in [start, end), so that reading and scanning can be done on different threads.
+// Batches have to be read and then scanned in order. Reading only touches the read position, and scanning the hits,
+// so one thread can read the next batch while another scans the last one.
+class StringExtractor {
+    public:
+    StringExtractor (HerixLib::FilePosition t_start, HerixLib::FilePosition t_end, const StringExtractOptions& t_options);
+
+    // Reads the batch after the last one which was read. Returns false once there are none left.
+    bool readBatch (EditLayer& hex, StringBatch& batch);
+    // Scans it over the option's threads
+    void scanBatch (const StringBatch& batch);
+    // The hits, sorted by offset, once every batch has been scanned
+    std::vector<StringHit> finish ();
+
+    HerixLib::FilePosition getStart () const;
+    HerixLib::FilePosition getEnd () const;
+
+    private:
+    // Each encoding/alignment pair is scanned as its own stream, since their runs can overlap
+    static constexpr size_t STREAM_COUNT = 3;
+
+    HerixLib::FilePosition start;
+    HerixLib::FilePosition end;
+    StringExtractOptions options;
+    unsigned int thread_count;
+    size_t chunk_size;
+    std::array<size_t, STREAM_COUNT> min_bytes;
+
+    HerixLib::FilePosition read_position;
+    bool read_finished = false;
+
+    std::array<std::vector<StringHit>, STREAM_COUNT> found;
+    std::array<std::optional<StringHit>, STREAM_COUNT> pending;
+};
+
+// A strings scan run in the background, for the strings panel. Herix isn't thread safe, so the batches are still
+// read on the main thread, in update(), while the worker scans the one before.
+class StringScanTask {
+    public:
+    // on_update is called from the worker thread whenever it's ready for another batch and once it is done, so it has
+    // to be thread safe.
+    StringScanTask (HerixLib::FilePosition start, HerixLib::FilePosition end, const StringExtractOptions& options,
+        std::function<void()> t_on_update = nullptr);
+    StringScanTask (const StringScanTask&) = delete;
+    StringScanTask& operator= (const StringScanTask&) = delete;
+    // Cancels the scan if it's still going
+    ~StringScanTask ();
+
+    // Reads the next batch if the worker has room for it. Returns true once the worker has finished.
+    bool update (EditLayer& hex);
+    bool isDone () const;
+    // How many bytes of the range have been scanned
+    HerixLib::FilePosition getProgress () const;
+    HerixLib::FilePosition getSize () const;
+    // Sorted by offset. Only filled in once it is done.
+    std::vector<StringHit> takeHits ();
+
+    private:
+    StringExtractor extractor;
+
+    // Shared with the worker
+    std::mutex worker_mutex;
+    std::condition_variable worker_wake;
+    // Read but not yet taken by the worker
+    std::optional<StringBatch> worker_queued;
+    bool worker_input_done = false;
+    std::atomic<HerixLib::FilePosition> worker_progress = 0;
+    std::atomic<bool> worker_done = false;
+    std::atomic<bool> worker_stop = false;
+    std::function<void()> on_update;
+    // Written by the worker before worker_done is set
+    std::vector<StringHit> hits;
+    std::thread worker;
+
+    void runWorker ();
+};
+
+// Finds all the strings in [start, end). The hits are sorted by offset.
+// The range is read in batches of (threads * chunk_size) bytes, so memory use outside of the hits is bounded.
+std::vector<StringHit> extractStrings (EditLayer& hex, HerixLib::FilePosition start, HerixLib::FilePosition end, const StringExtractOptions& options);
+
+#endif
@@ -1,5 +1,7 @@
 #include "./subview.hpp"
 
+#include <utility>
+
 // TODO: add function that clears subview
 
 SubView::SubView (ViewLocation t_loc, ViewWindow& t_view) : view(t_view), loc(t_loc) {}
@@ -19,6 +21,8 @@ void SubView::setupLua (sol::state& lua) {
         "getLoc", &SubView::getLoc,
         "setVisible", &SubView::setVisible,
         "getVisible", &SubView::getVisible,
+        "setFixedWidth", &SubView::setFixedWidth,
+        "getFixedWidth", &SubView::getFixedWidth,
         "onRender", &SubView::onRender,
         "clearOnRender", &SubView::clearOnRender,
         "onResize", &SubView::onResize,
@@ -65,18 +69,38 @@ void SubView::setVisible (bool val) {
 bool SubView::getVisible () const {
     return visible;
 }
+void SubView::setFixedWidth (bool val) {
+    fixed_width = val;
+}
+bool SubView::getFixedWidth () const {
+    return fixed_width;
+}
+void SubView::setName (std::string val) {
+    name = std::move(val);
+}
+const std::string& SubView::getName () const {
+    return name;
+}
 
 void SubView::onRender (sol::protected_function cb) {
     on_render = cb;
 }
 void SubView::clearOnRender () {
     on_render = sol::lua_nil;
+    native_render = nullptr;
 }
 void SubView::onResize (sol::protected_function cb) {
     on_resize = cb;
 }
 void SubView::clearOnResize () {
     on_resize = sol::lua_nil;
+    native_resize = nullptr;
+}
+void SubView::onRenderNative (std::function<void()> cb) {
+    native_render = cb;
+}
+void SubView::onResizeNative (std::function<void()> cb) {
+    native_resize = cb;
 }
 void SubView::print (std::string text) {
     view.print(text.c_str());
@@ -88,18 +112,26 @@ void SubView::printStandout (std::string text) {
     wattroff(view.win, A_STANDOUT);
 }
 void SubView::move (int to_x, int to_y) {
-    int move_x = getX() + to_x;
-    if (loc == ViewLocation::Right) {
-        move_x += view.getHexX() + view.getHexWidth();
-    } else if (loc == ViewLocation::Left) {}
+    int move_x = getViewX() + to_x;
     int move_y = view.getHexY() + getY() + to_y;
 
     view.move(move_x, move_y);
 }
+int SubView::getViewX () const {
+    int ret = getX();
+    if (loc == ViewLocation::Right) {
+        ret += view.getHexX() + view.getHexWidth() + view.getRightOffset(*this);
+    } else if (loc == ViewLocation::Left) {
+        ret += view.getLeftOffset(*this);
+    }
+    return ret;
+}
 
 
 void SubView::runRender () {
-    if (on_render) {
+    if (native_render) {
+        native_render();
+    } else if (on_render) {
         if (!on_render.is<sol::nil_t>()) {
             auto v = on_render();
             if (!v.valid()) {
@@ -111,7 +143,9 @@ void SubView::runRender () {
     }
 }
 void SubView::runResize () {
-    if (on_resize) {
+    if (native_resize) {
+        native_resize();
+    } else if (on_resize) {
         if (!on_resize.is<sol::nil_t>()) {
             auto v = on_resize();
             if (!v.valid()) {
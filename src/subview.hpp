@@ -9,6 +9,7 @@
 
 #pragma GCC diagnostic pop
 
+#include <functional>
 #include "./mutil.hpp"
 
 struct ViewWindow;
@@ -20,6 +21,8 @@ class SubView {
     int y = -1;
 
     bool visible = true;
+    // Fixed width views have their width taken out before the hex view (and views which scale with it) is laid out
+    bool fixed_width = false;
 
     ViewWindow& view;
 
@@ -28,7 +31,13 @@ class SubView {
     sol::protected_function on_render;
     sol::protected_function on_resize;
 
+    // For views implemented in C++. These are used instead of the lua callbacks if set.
+    std::function<void()> native_render;
+    std::function<void()> native_resize;
+
     ViewLocation loc = ViewLocation::NONE;
+    // What made it (the plugin's name), for telling views apart in the frame times
+    std::string name;
 
     public:
     SubView (ViewLocation t_loc, ViewWindow& t_view);
@@ -45,15 +54,24 @@ class SubView {
     ViewLocation getLoc () const;
     void setVisible (bool val);
     bool getVisible () const;
+    void setFixedWidth (bool val);
+    bool getFixedWidth () const;
+    void setName (std::string val);
+    const std::string& getName () const;
 
     void onRender (sol::protected_function cb);
     void clearOnRender ();
 
     void onResize (sol::protected_function cb);
     void clearOnResize ();
+
+    void onRenderNative (std::function<void()> cb);
+    void onResizeNative (std::function<void()> cb);
     void print (std::string text);
     void printStandout (std::string text);
     void move (int to_x, int to_y);
+    // Where the subview is on the window, after being placed next to the hex view and the other subviews.
+    int getViewX () const;
 
     void runRender ();
     void runResize ();
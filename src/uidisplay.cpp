@@ -1,5 +1,17 @@
 #include "./uidisplay.hpp"
 
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "./entropyview.hpp"
+#include "./minimapview.hpp"
+#include "./diffview.hpp"
+#include "./startupprofile.hpp"
+
 // Note: these two functions should be ignored after initialization!
 HerixLib::ChunkSize UIDisplay::getMaxChunkMemory () {
     return lua.get_or("max_chunk_memory", 1024*10UL);
@@ -7,51 +19,138 @@ HerixLib::ChunkSize UIDisplay::getMaxChunkMemory () {
 HerixLib::ChunkSize UIDisplay::getMaxChunkSize () {
     return lua.get_or("max_chunk_size", 1024UL);
 }
+size_t UIDisplay::getMaxEditMemory () {
+    return lua.get_or("max_edit_memory", 64 * 1024 * 1024UL);
+}
 
 
-UIDisplay::UIDisplay (std::filesystem::path t_filename, std::filesystem::path t_config_file, std::filesystem::path t_plugins_directory, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range, bool t_debug) {
+UIDisplay::UIDisplay (std::filesystem::path t_filename, std::filesystem::path t_config_file, std::filesystem::path t_plugins_directory, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range, bool t_debug,
+    std::optional<std::filesystem::path> t_diff_filename, FilePrimer* t_primer) {
     debug = t_debug;
     plugins_directory = t_plugins_directory;
     config_path = t_config_file;
+    filename = t_filename;
+    file_range = t_file_range;
 
     debugLog("Debug mode is on");
 
-    lua.open_libraries(
-        sol::lib::base, sol::lib::bit32, sol::lib::count, sol::lib::debug, sol::lib::ffi,
-        sol::lib::io, sol::lib::jit, sol::lib::math, sol::lib::os, sol::lib::package,
-        sol::lib::string, sol::lib::table, sol::lib::utf8
-    );
+    {
+        // The rest are opened when they're first used
+        StartupPhase phase("lua open_libraries");
+        lua_libraries.setup(lua);
+    }
+
+    {
+        StartupPhase phase("lua bindings");
+        setupSimpleLua();
+    }
 
-    setupSimpleLua();
+    std::optional<std::filesystem::path> cache_directory = getCacheDirectory();
+    if (cache_directory.has_value()) {
+        script_cache = ScriptCache(cache_directory.value() / "lua");
+    }
+
+    {
+        StartupPhase phase("config");
+        if (config_path == "") {
+            logAtExit("Loading Default Config..");
+            lua.script(UIDisplay::DEFAULT_CONFIG);
+        } else {
+            runScriptFile(config_path);
+        }
+    }
+
+    // The config itself has already been loaded through the cache by now, this is for the plugins
+    if (!lua.get_or("bytecode_cache", true)) {
+        script_cache = ScriptCache();
+    }
 
-    if (config_path == "") {
-        logAtExit("Loading Default Config..");
-        lua.script(UIDisplay::DEFAULT_CONFIG);
+    std::string library_profile = lua.get_or<std::string>("lua_libraries", "full");
+    if (std::optional<LuaLibraryProfile> profile = LuaSandbox::parseProfile(library_profile)) {
+        lua_libraries.setProfile(profile.value());
     } else {
-        auto result = lua.script_file(config_path);
-        if (!result.valid()) {
-            // TODO: these checks might be useless?
-            if (result.status() == sol::call_status::file) {
-                if (std::filesystem::exists(config_path)) {
-                    // TODO: display the error
-                    exit_logs.push_back("File exists but there was a file error.\n");
+        logAtExit("Unknown lua_libraries '" + library_profile + "', expected 'full' or 'minimal'. Using 'full'.");
+    }
+
+    // Has been reading the file since main started, so it should be done by now. Waited on before recovering a
+    // save, so that it's not reading while the file is written.
+    if (t_primer != nullptr) {
+        StartupPhase phase("waiting on file primer");
+        file_start = t_primer->takeStart();
+    }
+
+    // A save that was cut off is finished before anything reads the file
+    std::string recovery_message = "";
+    if (std::filesystem::exists(EditLayer::getJournalPath(t_filename))) {
+        StartupPhase phase("save journal recovery");
+        // What was primed is from before the save was finished
+        file_start.clear();
+        if (!t_allow_writing) {
+            recovery_message = "A save of this file was interrupted, open it without --no_writing to finish it.";
+        } else {
+            try {
+                if (EditLayer::recoverJournal(t_filename) == JournalRecovery::Replayed) {
+                    recovery_message = "Finished a save that was interrupted.";
+                } else {
+                    recovery_message = "Discarded an interrupted save, the file was not changed by it.";
                 }
+            } catch (const std::runtime_error& err) {
+                recovery_message = std::string("Could not finish an interrupted save: ") + err.what();
             }
         }
     }
 
-    hex = HerixLib::Herix(t_filename, t_allow_writing, file_range, getMaxChunkMemory(), getMaxChunkSize());
+    {
+        StartupPhase phase("open file");
+        hex = EditLayer(t_filename, t_allow_writing, t_file_range, getMaxChunkMemory(), getMaxChunkSize());
+        hex.setMemoryBudget(getMaxEditMemory());
+    }
 
-    setupBar();
-    setupView();
+    loadKeymap();
+
+    std::optional<std::filesystem::path> state_directory = getStateDirectory();
+    if (lua.get_or("persistent_undo", true) && state_directory.has_value()) {
+        StartupPhase phase("undo history");
+        try {
+            size_t restored = hex.openHistory(UndoJournal::getPath(state_directory.value(), t_filename, t_file_range));
+            if (restored != 0 && recovery_message.empty()) {
+                recovery_message = "Restored " + std::to_string(restored) + " edits from the last session, redo to apply them.";
+            }
+        } catch (const std::runtime_error& err) {
+            logAtExit(std::string("Undo history is not kept: ") + err.what());
+            if (recovery_message.empty()) {
+                recovery_message = std::string("Undo history is not kept: ") + err.what();
+            }
+        }
+    }
+
+    {
+        StartupPhase phase("windows");
+        setupBar();
+        setupView();
+    }
 
     setupLuaValues();
-    loadPlugins ();
+    // Before the plugins, so it is the first view on the right, next to the hex view.
+    if (t_diff_filename.has_value()) {
+        StartupPhase phase("diff view");
+        createDiffView(t_diff_filename.value());
+    }
+    {
+        StartupPhase phase("plugins");
+        loadPlugins();
+    }
+    file_start = std::vector<HerixLib::Byte>();
 
     state = UIState::Hex;
+    if (!recovery_message.empty()) {
+        setBarMessage(recovery_message);
+    }
 }
 
 UIDisplay::~UIDisplay () {
+    // So the edit being typed when exiting is in the history as well
+    hex.endEditSession();
     delwin(bar.win);
     delwin(view.win);
 }
@@ -70,6 +169,14 @@ void UIDisplay::setEditingPosition (bool val) {
 }
 
 void UIDisplay::registerInfo (std::string name, sol::function cb) {
+    // Fills in the entry of a plugin which was listed before it was loaded
+    for (InformationNote& note : information_notes) {
+        if (note.name == name && note.lazy_plugin.has_value()) {
+            note.text_func = cb;
+            note.lazy_plugin = std::nullopt;
+            return;
+        }
+    }
     information_notes.push_back(InformationNote(name, cb));
 }
 void UIDisplay::deregisterInfo (std::string name) {
@@ -157,12 +264,39 @@ void UIDisplay::setShouldEditMoveForward (bool val) {
 }
 
 unsigned int UIDisplay::registerKeyHandler (sol::protected_function handler) {
-    key_handlers.push_back(std::make_pair(key_handler_id, handler));
+    key_handlers[key_handler_id] = handler;
+    key_handler_table.add(key_handler_id, KeyHandlerTable::ANY, KeyHandlerTable::ANY, KeyHandlerTable::ANY);
     return key_handler_id++;
 }
 
-void UIDisplay::removeKeyHandler (int id) {
-    // TODO: implement this
+unsigned int UIDisplay::registerKeyHandlerFor (sol::object key_value, sol::protected_function handler, sol::optional<UIState> for_ui_state, sol::optional<HexViewState> for_hex_view_state) {
+    int key_code;
+    if (key_value.get_type() == sol::type::number) {
+        key_code = key_value.as<int>();
+    } else if (key_value.get_type() == sol::type::string && key_value.as<std::string>().size() == 1) {
+        key_code = static_cast<unsigned char>(key_value.as<std::string>()[0]);
+    } else {
+        throw std::runtime_error("registerKeyHandlerFor needs a key code or a single character.");
+    }
+
+    key_handlers[key_handler_id] = handler;
+    key_handler_table.add(key_handler_id, key_code,
+        for_ui_state ? static_cast<int>(for_ui_state.value()) : KeyHandlerTable::ANY,
+        for_hex_view_state ? static_cast<int>(for_hex_view_state.value()) : KeyHandlerTable::ANY);
+    return key_handler_id++;
+}
+
+bool UIDisplay::removeKeyHandler (unsigned int id) {
+    if (!key_handler_table.remove(id)) {
+        return false;
+    }
+
+    if (handling_keys) {
+        removed_key_handlers.push_back(id);
+    } else {
+        key_handlers.erase(id);
+    }
+    return true;
 }
 
 bool UIDisplay::setBarMessage (std::string value) {
@@ -179,23 +313,166 @@ std::string UIDisplay::getBarMessage () {
     return bar_message;
 }
 
-// TODO: make this invalidate the cache if the file is saved.
 size_t UIDisplay::getFileEnd () {
-    if (cached_file_end.has_value()) {
-        return cached_file_end.value();
-    } else {
-        cached_file_end = hex.getFileEnd();
-        return cached_file_end.value();
-    }
+    return hex.getFileEnd();
 }
 
 size_t UIDisplay::createSubView (ViewLocation loc) {
     view.sub_views.push_back(SubView(loc, view));
+    view.sub_views.back().setName(loading_plugin);
     return view.sub_views.size() - 1;
 }
 SubView& UIDisplay::getSubView (size_t id) {
     return view.sub_views.at(id);
 }
+size_t UIDisplay::createEntropyView () {
+    getFileSummary();
+
+    size_t id = createSubView(ViewLocation::Right);
+    SubView& sub_view = getSubView(id);
+    sub_view.setFixedWidth(true);
+    sub_view.setWidth(2);
+
+    // Note: these use the id rather than the SubView, since creating more subviews can move it
+    auto resize = [this, id] () {
+        SubView& sv = getSubView(id);
+        sv.setHeight(view.getHexHeight());
+        sv.setX(0);
+        sv.setY(0);
+    };
+    resize();
+    sub_view.onResizeNative(resize);
+    sub_view.onRenderNative([this, id] () {
+        HerixLib::FilePosition view_start = getRowOffset();
+        HerixLib::FilePosition page_size = static_cast<HerixLib::FilePosition>(view.getHexByteWidth()) *
+            static_cast<HerixLib::FilePosition>(view.getHexHeight());
+        renderEntropyView(getSubView(id), view, *file_summary, view_start, view_start + page_size);
+    });
+
+    return id;
+}
+
+size_t UIDisplay::createMinimapView () {
+    if (minimap.has_value()) {
+        // There's only one set of keys to control it with, so only one is allowed.
+        return minimap->sub_view_id;
+    }
+
+    getFileSummary();
+
+    size_t id = createSubView(ViewLocation::Right);
+    SubView& sub_view = getSubView(id);
+    sub_view.setFixedWidth(true);
+    sub_view.setWidth(3);
+    minimap = MinimapView(id);
+
+    auto resize = [this, id] () {
+        SubView& sv = getSubView(id);
+        sv.setHeight(view.getHexHeight());
+        sv.setX(0);
+        sv.setY(0);
+    };
+    resize();
+    sub_view.onResizeNative(resize);
+    sub_view.onRenderNative([this, id] () {
+        HerixLib::FilePosition view_start = getRowOffset();
+        HerixLib::FilePosition page_size = static_cast<HerixLib::FilePosition>(view.getHexByteWidth()) *
+            static_cast<HerixLib::FilePosition>(view.getHexHeight());
+        minimap->render(getSubView(id), view, *file_summary, view_start, view_start + page_size);
+    });
+
+    return id;
+}
+
+size_t UIDisplay::createDataInspectorView () {
+    if (inspector.has_value()) {
+        // Toggled by a single key, so there's only one
+        return inspector->sub_view_id;
+    }
+
+    size_t id = createSubView(ViewLocation::Right);
+    SubView& sub_view = getSubView(id);
+    sub_view.setFixedWidth(true);
+    sub_view.setWidth(28);
+    inspector = DataInspectorView(id);
+
+    auto resize = [this, id] () {
+        SubView& sv = getSubView(id);
+        sv.setHeight(view.getHexHeight());
+        sv.setX(0);
+        sv.setY(0);
+    };
+    resize();
+    sub_view.onResizeNative(resize);
+    // The fields are updated in drawView, from the bytes the hex view was drawn from
+    sub_view.onRenderNative([this, id] () {
+        inspector->render(getSubView(id));
+    });
+
+    return id;
+}
+
+size_t UIDisplay::createDiffView (std::filesystem::path other) {
+    DiffOptions options;
+    options.block_size = lua.get_or("diff_block_size", options.block_size);
+    options.max_window = lua.get_or("diff_max_window", options.max_window);
+
+    diff_hex = std::make_unique<HerixLib::Herix>(other, false, std::make_pair(HerixLib::AbsoluteFilePosition(0), std::nullopt),
+        getMaxChunkMemory(), getMaxChunkSize());
+    diff = std::make_unique<DiffEngine>(filename, file_range, other, options, [this] () { wakeFromWorker(); });
+
+    // As wide as the hex view, which it takes a share of per byte
+    view.extra_byte_columns += 3;
+    size_t id = createSubView(ViewLocation::Right);
+    auto resize = [this, id] () {
+        SubView& sv = getSubView(id);
+        sv.setWidth(view.getHexByteWidth() * 3);
+        sv.setHeight(view.getHexHeight());
+        sv.setX(0);
+        sv.setY(0);
+    };
+    resize();
+    getSubView(id).onResizeNative(resize);
+    getSubView(id).onRenderNative([this, id] () {
+        // Kept in sync by showing what lines up with the top of the hex view
+        renderDiffView(getSubView(id), view, *diff_hex, *diff, diff->mapToB(getRowOffset()),
+            static_cast<size_t>(view.getHexByteWidth()));
+    });
+
+    return id;
+}
+
+bool UIDisplay::isDiffMode () const {
+    return diff != nullptr;
+}
+bool UIDisplay::isDiffPosition (HerixLib::FilePosition pos) const {
+    return diff && diff->isDifferentA(pos);
+}
+size_t UIDisplay::getDiffHunkCount () const {
+    return diff ? diff->getHunks().size() : 0;
+}
+
+FileSummary& UIDisplay::getFileSummary () {
+    if (!file_summary) {
+        file_summary = std::make_unique<FileSummary>(filename, file_range, getFileEnd(), [this] () { wakeFromWorker(); });
+    }
+    return *file_summary;
+}
+
+void UIDisplay::markModified (HerixLib::FilePosition pos, size_t length) {
+    if (file_summary) {
+        file_summary->markDirty(pos, length);
+    }
+}
+void UIDisplay::markLayoutChanged (HerixLib::FilePosition pos) {
+    if (file_summary) {
+        file_summary->resize(getFileEnd(), pos);
+    }
+    size_t file_end = getFileEnd();
+    if (sel_pos >= file_end) {
+        sel_pos = file_end == 0 ? 0 : file_end - 1;
+    }
+}
 
 HerixLib::FilePosition UIDisplay::getSelectedRow () {
     // TODO: the rounding down might be unneeded?
@@ -223,6 +500,120 @@ HerixLib::Byte UIDisplay::lua_readByte (HerixLib::FilePosition pos) {
 std::vector<HerixLib::Byte> UIDisplay::lua_readBytes (HerixLib::FilePosition pos, size_t length) {
     return hex.readMultipleCutoff(pos, length);
 }
+std::string UIDisplay::lua_hashRange (std::string algorithm, HerixLib::FilePosition pos, size_t length) {
+    std::optional<HashAlgorithm> parsed = parseHashAlgorithm(algorithm);
+    if (!parsed.has_value()) {
+        throw std::runtime_error("Unknown hash algorithm: '" + algorithm + "'");
+    }
+    return hashRange(hex, parsed.value(), pos, length);
+}
+sol::object UIDisplay::lua_fileHashes (sol::table algorithms) {
+    std::vector<std::string> names;
+    std::vector<HashAlgorithm> parsed;
+    for (size_t i = 1; i <= algorithms.size(); i++) {
+        std::string name = algorithms.get<std::string>(i);
+        std::optional<HashAlgorithm> algorithm = parseHashAlgorithm(name);
+        if (!algorithm.has_value()) {
+            throw std::runtime_error("Unknown hash algorithm: '" + name + "'");
+        }
+        names.push_back(name);
+        parsed.push_back(algorithm.value());
+    }
+
+    uint64_t version = hex.getVersion();
+    bool cached = file_hashes_version == version && std::all_of(names.begin(), names.end(),
+        [this] (const std::string& name) {
+            return file_hashes.count(name) != 0;
+        }
+    );
+    if (cached) {
+        sol::table ret = lua.create_table();
+        for (const std::string& name : names) {
+            ret[name] = file_hashes.at(name);
+        }
+        return ret;
+    }
+
+    // Every algorithm is done in the same pass over the file, which is spread over the idle loop
+    if (!file_hash || file_hash->version != version || file_hash->names != names) {
+        file_hash = std::make_unique<FileHashTask>(names, StreamingHash(parsed, 0, getFileEnd()), version);
+    }
+    return sol::make_object(lua, sol::lua_nil);
+}
+sol::table UIDisplay::lua_editMemoryStats () {
+    EditMemoryStats stats = hex.getMemoryStats();
+
+    sol::table ret = lua.create_table();
+    ret["resident"] = stats.resident;
+    ret["spilled"] = stats.spilled;
+    return ret;
+}
+
+EventLoop::TimerID UIDisplay::lua_setTimeout (sol::protected_function cb, int64_t ms) {
+    return events.addTimer(std::chrono::milliseconds(std::max<int64_t>(ms, 0)), std::nullopt, [this, cb] () {
+        auto res = cb();
+        if (!res.valid()) {
+            logAtExit("Error in timeout callback!");
+            sol::error err = res;
+            throw err;
+        }
+        handleDrawing();
+    });
+}
+EventLoop::TimerID UIDisplay::lua_setInterval (sol::protected_function cb, int64_t ms) {
+    // At least a millisecond, otherwise it would always be due and the loop would never get to sleep
+    std::chrono::milliseconds interval(std::max<int64_t>(ms, 1));
+    return events.addTimer(interval, interval, [this, cb] () {
+        auto res = cb();
+        if (!res.valid()) {
+            logAtExit("Error in interval callback!");
+            sol::error err = res;
+            throw err;
+        }
+        handleDrawing();
+    });
+}
+bool UIDisplay::lua_clearTimer (EventLoop::TimerID id) {
+    return events.cancelTimer(id);
+}
+sol::table UIDisplay::lua_rangeStats (HerixLib::FilePosition pos, size_t length) {
+    return makeRangeStatsTable(computeRangeStats(hex, pos, length));
+}
+sol::object UIDisplay::lua_fileStats () {
+    uint64_t version = hex.getVersion();
+    if (file_stats.has_value() && file_stats_version == version) {
+        return makeRangeStatsTable(file_stats.value());
+    }
+
+    // Counted over the idle loop rather than all at once
+    if (!file_stats_task || file_stats_task->version != version) {
+        file_stats_task = std::make_unique<FileStatsTask>(version);
+    }
+    return sol::make_object(lua, sol::lua_nil);
+}
+sol::table UIDisplay::makeRangeStatsTable (const RangeStats& stats) {
+    sol::table ret = lua.create_table();
+    ret["total"] = stats.total;
+    ret["zeroes"] = stats.histogram[0];
+    ret["zero_runs"] = stats.zero_runs;
+    ret["longest_zero_run"] = stats.longest_zero_run;
+    ret["printable"] = stats.getPrintable();
+    ret["printable_ratio"] = stats.getPrintableRatio();
+    ret["entropy"] = stats.getEntropy();
+    // Left as nil for an empty range
+    if (stats.total != 0) {
+        ret["min"] = stats.getMin().value();
+        ret["max"] = stats.getMax().value();
+    }
+
+    // Indexed by the byte value itself, so from 0 to 255
+    sol::table histogram = lua.create_table(0, 256);
+    for (size_t v = 0; v < 256; v++) {
+        histogram[v] = stats.histogram[v];
+    }
+    ret["histogram"] = histogram;
+    return ret;
+}
 HerixLib::FilePosition UIDisplay::getRowOffset () const {
     return row_pos * static_cast<HerixLib::FilePosition>(view.getHexByteWidth());
 }
@@ -242,6 +633,9 @@ HexViewState UIDisplay::getHexViewState () const {
     return hex_view_state;
 }
 void UIDisplay::setHexViewState (HexViewState val) {
+    if (val != hex_view_state) {
+        hex.endEditSession();
+    }
     hex_view_state = val;
 }
 
@@ -270,7 +664,8 @@ void UIDisplay::setupSimpleLua () {
         "Default", UIState::Default,
         "Hex", UIState::Hex,
         "InfoAsking", UIState::InfoAsking,
-        "Info", UIState::Info
+        "Info", UIState::Info,
+        "Strings", UIState::Strings
     );
     lua.new_enum("HexViewState",
         "Default", HexViewState::Default,
@@ -397,6 +792,7 @@ void UIDisplay::setupSimpleLua () {
     lua.set_function("getConfigPath", &UIDisplay::getConfigPath, this);
 
     lua.set_function("registerKeyHandler", &UIDisplay::registerKeyHandler, this);
+    lua.set_function("registerKeyHandlerFor", &UIDisplay::registerKeyHandlerFor, this);
     lua.set_function("removeKeyHandler", &UIDisplay::removeKeyHandler, this);
     lua.set_function("getNextKeyHandlerID", &UIDisplay::getNextKeyHandlerID, this);
 
@@ -411,6 +807,12 @@ void UIDisplay::setupLuaValues () {
     // Subview
     lua.set_function("createSubView", &UIDisplay::createSubView, this);
     lua.set_function("getSubView", &UIDisplay::getSubView, this);
+    lua.set_function("createEntropyView", &UIDisplay::createEntropyView, this);
+    lua.set_function("createMinimapView", &UIDisplay::createMinimapView, this);
+    lua.set_function("createDataInspectorView", &UIDisplay::createDataInspectorView, this);
+    lua.set_function("isDiffMode", &UIDisplay::isDiffMode, this);
+    lua.set_function("isDiffPosition", &UIDisplay::isDiffPosition, this);
+    lua.set_function("getDiffHunkCount", &UIDisplay::getDiffHunkCount, this);
 
     // Utility
     lua.set_function("moveView", &ViewWindow::move, &view);
@@ -423,6 +825,13 @@ void UIDisplay::setupLuaValues () {
     lua.set_function("undoEdit", &UIDisplay::undo, this);
     lua.set_function("redoEdit", &UIDisplay::redo, this);
     lua.set_function("listenForUndo", &UIDisplay::listenForUndo, this);
+    lua.set_function("replaceAll", &UIDisplay::replaceAll, this);
+    lua.set_function("insertBytes", &UIDisplay::insertBytes, this);
+    lua.set_function("eraseBytes", &UIDisplay::eraseBytes, this);
+    lua.set_function("fillRange", &UIDisplay::fillRange, this);
+    lua.set_function("pasteFromFile", &UIDisplay::pasteFromFile, this);
+    lua.set_function("isReplacing", &UIDisplay::isReplacing, this);
+    lua.set_function("cancelReplace", &UIDisplay::cancelReplace, this);
     lua.set_function("listenForRedo", &UIDisplay::listenForRedo, this);
 
     lua.set_function("listenForInit", &UIDisplay::listenForInit, this);
@@ -448,6 +857,20 @@ void UIDisplay::setupLuaValues () {
     lua.set_function("hasByte", &UIDisplay::lua_hasByte, this);
     lua.set_function("readByte", &UIDisplay::lua_readByte, this);
     lua.set_function("readBytes", &UIDisplay::lua_readBytes, this);
+    lua.set_function("hashRange", &UIDisplay::lua_hashRange, this);
+    lua.set_function("rangeStats", &UIDisplay::lua_rangeStats, this);
+    lua.set_function("fileHashes", &UIDisplay::lua_fileHashes, this);
+    lua.set_function("fileStats", &UIDisplay::lua_fileStats, this);
+    lua.set_function("editMemoryStats", &UIDisplay::lua_editMemoryStats, this);
+
+    // Timers
+    lua.set_function("setTimeout", &UIDisplay::lua_setTimeout, this);
+    lua.set_function("setInterval", &UIDisplay::lua_setInterval, this);
+    lua.set_function("clearTimer", &UIDisplay::lua_clearTimer, this);
+    lua.set_function("getHashImplementation", [] (std::string algorithm) -> std::string {
+        std::optional<HashAlgorithm> parsed = parseHashAlgorithm(algorithm);
+        return parsed.has_value() ? getHashImplementation(parsed.value()) : "";
+    });
 
     // Information - Row
     lua.set_function("getRowPosition", &UIDisplay::getRowPosition, this);
@@ -477,6 +900,7 @@ void UIDisplay::setupLuaValues () {
     lua.set_function("getHexByteWidth", &ViewWindow::getHexByteWidth, &view);
     lua.set_function("getLeftViewsWidth", &ViewWindow::getLeftWidth, &view);
     lua.set_function("getRightViewsWidth", &ViewWindow::getRightWidth, &view);
+    lua.set_function("getFixedRightViewsWidth", &ViewWindow::getFixedRightWidth, &view);
 
     lua.set_function("getHexViewState", &UIDisplay::getHexViewState, this);
     lua.set_function("setHexViewState", &UIDisplay::setHexViewState, this);
@@ -512,6 +936,8 @@ void UIDisplay::loadPlugins () {
         return;
     }
 
+    auto start_time = std::chrono::steady_clock::now();
+
     // Arrays are just tables with ints for keys
     sol::table plugins;
 
@@ -533,18 +959,134 @@ void UIDisplay::loadPlugins () {
                 // Get value
                 std::string plugin_filename = plugins[plugin].get<std::string>();
                 loadPlugin(plugin_filename);
+            } else if (plugins[plugin].get_type() == sol::type::table) {
+                loadPluginManifest(plugins[plugin].get<sol::table>());
             } else {
-                exit_logs.push_back("Couldn't load plugin in plugin list as it's value was not a string.");
+                exit_logs.push_back("Couldn't load plugin in plugin list as it's value was not a string or table.");
             }
         } else {
             exit_logs.push_back("Had issues getting plugin value. This is probably an issue in the hex editor. Please report");
         }
     }
+
+    std::string opened_libraries;
+    for (const std::string& library : lua_libraries.getOpenedLibraries()) {
+        opened_libraries += (opened_libraries.empty() ? "" : ", ") + library;
+    }
+    debugLog("Lua libraries opened on use: " + (opened_libraries.empty() ? std::string("none") : opened_libraries));
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_time;
+    debugLog("Loaded plugins in " + std::to_string(elapsed.count()) + "ms (" + std::to_string(script_cache.getHits()) +
+        " from the bytecode cache, " + std::to_string(script_cache.getMisses()) + " compiled, " +
+        std::to_string(lazy_plugins.size()) + " waiting on a trigger)");
+}
+
+void UIDisplay::loadPluginManifest (sol::table manifest) {
+    sol::optional<std::string> path = manifest["path"];
+    if (!path) {
+        exit_logs.push_back("Couldn't load plugin in plugin list as it had no path.");
+        return;
+    }
+
+    std::vector<std::string> libraries;
+    sol::optional<sol::table> granted = manifest["libraries"];
+    if (granted) {
+        for (auto& [library_index, library] : granted.value()) {
+            if (library.get_type() == sol::type::string) {
+                libraries.push_back(library.as<std::string>());
+            }
+        }
+    }
+
+    // Decided right away, since the start of the file is already there to look at
+    sol::optional<std::string> magic = manifest["magic"];
+    if (magic) {
+        StartupPhase phase("format check " + path.value());
+        size_t offset = manifest.get_or("magic_offset", size_t(0));
+        std::vector<HerixLib::Byte> found;
+        if (offset <= file_start.size() && magic->size() <= file_start.size() - offset) {
+            found.assign(file_start.begin() + static_cast<long>(offset), file_start.begin() + static_cast<long>(offset + magic->size()));
+        } else {
+            found = hex.readMultipleCutoff(offset, magic->size());
+        }
+        if (found.size() == magic->size() && std::equal(found.begin(), found.end(), magic->begin(),
+            [] (HerixLib::Byte a, char b) { return a == static_cast<HerixLib::Byte>(b); })) {
+            runPlugin(path.value(), libraries);
+        } else {
+            debugLog("Skipping plugin, the file doesn't start with its magic: '" + path.value() + "'");
+        }
+        return;
+    }
+
+    sol::optional<sol::table> keys = manifest["keys"];
+    sol::optional<std::string> info = manifest["info"];
+    if (!keys && !info) {
+        runPlugin(path.value(), libraries);
+        return;
+    }
+
+    size_t index = lazy_plugins.size();
+    lazy_plugins.push_back(LazyPlugin{path.value(), libraries, false});
+    if (keys) {
+        for (auto& [key_index, key_value] : keys.value()) {
+            if (key_value.get_type() == sol::type::number) {
+                lazy_key_plugins[key_value.as<int>()].push_back(index);
+            } else if (key_value.get_type() == sol::type::string && key_value.as<std::string>().size() == 1) {
+                lazy_key_plugins[static_cast<unsigned char>(key_value.as<std::string>()[0])].push_back(index);
+            }
+        }
+    }
+    if (info) {
+        // Listed right away, its text can only be had once it is loaded
+        information_notes.push_back(InformationNote(info.value(), index));
+    }
+}
+
+void UIDisplay::activatePlugin (size_t index) {
+    if (lazy_plugins.at(index).loaded) {
+        return;
+    }
+    lazy_plugins.at(index).loaded = true;
+    runPlugin(lazy_plugins.at(index).path, lazy_plugins.at(index).libraries);
 }
 /// Takes the FULL path of the plugin.
 void UIDisplay::loadPlugin (const std::string& plugin_filename) {
+    runPlugin(plugin_filename, {});
+}
+
+void UIDisplay::runPlugin (const std::string& plugin_filename, const std::vector<std::string>& libraries) {
     debugLog("Loading plugin: '" + plugin_filename + "'");
-    lua.script_file(plugin_filename);
+    StartupPhase phase("plugin " + plugin_filename);
+
+    std::vector<std::string> unknown;
+    std::optional<sol::environment> environment = lua_libraries.createEnvironment(lua, libraries, unknown);
+    for (const std::string& name : unknown) {
+        logAtExit("Plugin '" + plugin_filename + "' was granted '" + name + "', which is not a library.");
+    }
+
+    // Plugins can load other plugins
+    std::string previous_plugin = std::move(loading_plugin);
+    loading_plugin = std::filesystem::path(plugin_filename).stem().string();
+    runScriptFile(plugin_filename, environment);
+    loading_plugin = std::move(previous_plugin);
+}
+
+void UIDisplay::runScriptFile (const std::filesystem::path& path, const std::optional<sol::environment>& environment) {
+    sol::load_result loaded = script_cache.load(lua, path);
+    if (!loaded.valid()) {
+        sol::error err = loaded;
+        throw err;
+    }
+
+    sol::protected_function chunk = loaded.get<sol::protected_function>();
+    if (environment.has_value()) {
+        sol::set_environment(environment.value(), chunk);
+    }
+    auto result = chunk();
+    if (!result.valid()) {
+        sol::error err = result;
+        throw err;
+    }
 }
 
 void UIDisplay::setupBar () {
@@ -581,30 +1123,34 @@ void UIDisplay::updateViewProperties () {
 }
 
 void UIDisplay::drawBar () {
-    //wclear(bar.win);
-    werase(bar.win);
-    bar.moveOrigin();
-
-    wattron(bar.win, A_STANDOUT);
-
-    if (bar_asking == UIBarAsking::ShouldExit) {
-        bar.print("Are you sure you want to exit? (y/N)");
-    } else if (bar_asking == UIBarAsking::ShouldSave) {
-        bar.print("Are you sure you want to save? (y/N)");
-    } else if (!bar_message.empty()) {
-        bar.print(bar_message, 0, false);
-        clearBarMessage();
+    {
+        FrameTimes::Scope timing(frame_times, FrameTimes::BAR);
+        //wclear(bar.win);
+        werase(bar.win);
+        bar.moveOrigin();
+
+        wattron(bar.win, A_STANDOUT);
+
+        if (bar_asking == UIBarAsking::ShouldExit) {
+            bar.print("Are you sure you want to exit? (y/N)");
+        } else if (bar_asking == UIBarAsking::ShouldSave) {
+            bar.print("Are you sure you want to save? (y/N)");
+        } else if (bar_asking == UIBarAsking::Command) {
+            bar.print(":" + bar_input);
+        } else if (!bar_message.empty()) {
+            bar.print(bar_message, 0, false);
+            clearBarMessage();
+        }
     }
 
+    FrameTimes::Scope timing(frame_times, FrameTimes::FLUSH);
     wrefresh(bar.win);
 }
 
 void UIDisplay::drawView () {
-    //wclear(view.win);
-    werase(view.win);
-
-    for (SubView& sv : view.sub_views) {
-        sv.runResize();
+    for (size_t i = 0; i < view.sub_views.size(); i++) {
+        FrameTimes::Scope timing(frame_times, getSubViewStages(i).second);
+        view.sub_views[i].runResize();
     }
 
     // Draw hex-view
@@ -612,19 +1158,86 @@ void UIDisplay::drawView () {
 
     HerixLib::FilePosition file_pos = getRowOffset();
     size_t max_size = static_cast<size_t>(view.getHexByteWidth()) * static_cast<size_t>(view.getHexHeight());
-    std::vector<HerixLib::Byte> data = hex.readMultipleCutoff(file_pos, max_size);
-    runWriteListeners(data, file_pos);
+    // A little past the end of the page, so the inspector has all of its bytes even on the last row
+    size_t lookahead = inspector.has_value() ? DataInspectorView::MAX_BYTES : 0;
+    std::vector<HerixLib::Byte> data;
+    {
+        FrameTimes::Scope timing(frame_times, FrameTimes::READ);
+        data = hex.readMultipleCutoff(file_pos, max_size + lookahead);
+    }
 
-    for (SubView& sv : view.sub_views) {
-        sv.move(0, 0);
+    bool keep_inspector = false;
+    if (inspector.has_value() && getSubView(inspector->sub_view_id).getVisible()) {
+        bool changed;
+        if (sel_pos >= file_pos && sel_pos - file_pos < data.size()) {
+            size_t offset = sel_pos - file_pos;
+            changed = inspector->update(sel_pos, data.data() + offset, data.size() - offset);
+        } else {
+            std::vector<HerixLib::Byte> at_cursor;
+            {
+                FrameTimes::Scope timing(frame_times, FrameTimes::READ);
+                at_cursor = hex.readMultipleCutoff(sel_pos, DataInspectorView::MAX_BYTES);
+            }
+            changed = inspector->update(sel_pos, at_cursor.data(), at_cursor.size());
+        }
+
+        const SubView& sub_view = getSubView(inspector->sub_view_id);
+        std::array<int, 4> area = {sub_view.getViewX(), view.getHexY() + sub_view.getY(), sub_view.getWidth(), sub_view.getHeight()};
+        keep_inspector = !changed && inspector_area == area;
+        inspector_area = area;
+    } else {
+        inspector_area = std::nullopt;
+    }
 
-        sv.runRender();
+    // The inspector is left as it was drawn while its fields and its place on the view stay the same
+    if (keep_inspector) {
+        eraseViewExcept(inspector_area.value());
+    } else {
+        werase(view.win);
+    }
+
+    if (data.size() > max_size) {
+        data.resize(max_size);
+    }
+    {
+        FrameTimes::Scope timing(frame_times, FrameTimes::WRITE_LISTENERS);
+        runWriteListeners(data, file_pos);
     }
 
+    for (size_t i = 0; i < view.sub_views.size(); i++) {
+        FrameTimes::Scope timing(frame_times, getSubViewStages(i).first);
+        if (keep_inspector && i == inspector->sub_view_id) {
+            continue;
+        }
+        view.sub_views[i].move(0, 0);
+
+        view.sub_views[i].runRender();
+    }
+
+    FrameTimes::Scope timing(frame_times, FrameTimes::FLUSH);
     wrefresh(view.win);
 }
 
+void UIDisplay::eraseViewExcept (const std::array<int, 4>& area) {
+    const auto [x, y, width, height] = area;
+    for (int row = 0; row < view.height; row++) {
+        if (row < y || row >= y + height) {
+            wmove(view.win, row, 0);
+            wclrtoeol(view.win);
+            continue;
+        }
+        if (x > 0) {
+            mvwhline(view.win, row, 0, ' ', x);
+        }
+        if (x + width < view.width) {
+            wmove(view.win, row, x + width);
+            wclrtoeol(view.win);
+        }
+    }
+}
+
 void UIDisplay::resize () {
+    inspector_area = std::nullopt;
     updateBarProperties();
     updateViewProperties();
     bar.update();
@@ -641,12 +1254,38 @@ void UIDisplay::resize () {
 
 void UIDisplay::saveFile () {
     runSaveListeners();
-    hex.saveHistoryDestructive();
-    invalidateCaches();
+    try {
+        SaveStats stats = hex.saveHistoryDestructive(lua.get_or("atomic_save", false));
+        setBarMessage("Saved " + std::to_string(stats.bytes) + " bytes in " + std::to_string(stats.extents) + " writes (" +
+            std::to_string(static_cast<long>(stats.seconds * 1000.0)) + "ms" + (stats.journaled ? ", journaled" : "") + ").");
+    } catch (const std::runtime_error& err) {
+        setBarMessage(std::string("Could not save: ") + err.what());
+    }
 }
 
-void UIDisplay::invalidateCaches () {
-    cached_file_end = std::nullopt;
+bool UIDisplay::replaceAll (std::vector<HerixLib::Byte> find, std::vector<HerixLib::Byte> replacement) {
+    if (find.empty()) {
+        setBarMessage("Nothing to search for.");
+        return false;
+    } else if (find.size() != replacement.size()) {
+        setBarMessage("Replacement has to be the same length as what it replaces.");
+        return false;
+    } else if (replace_all) {
+        setBarMessage("Already replacing.");
+        return false;
+    }
+
+    replace_all = std::make_unique<ReplaceAllTask>(find, replacement, hex.getVersion());
+    return true;
+}
+bool UIDisplay::isReplacing () const {
+    return replace_all != nullptr;
+}
+void UIDisplay::cancelReplace () {
+    if (replace_all) {
+        replace_all.reset();
+        setBarMessage("Replace cancelled.");
+    }
 }
 
 void UIDisplay::listenForUndo (sol::protected_function cb) {
@@ -657,16 +1296,17 @@ void UIDisplay::listenForRedo (sol::protected_function cb) {
 }
 
 void UIDisplay::undo (bool dialog) {
-    HerixLib::UndoInfo info = hex.undo();
-    if (info.wasSuccess()) {
-        auto& item = info.undone.value();
-        sel_pos = item.pos;
+    std::optional<EditChange> change = hex.undo();
+    if (change.has_value()) {
+        sel_pos = change->start;
         if (dialog) {
-            setBarMessage("Undid " + std::to_string(item.data.size()) + " bytes.");
+            setBarMessage("Undid changes to " + std::to_string(change->length) + " bytes.");
         }
+        markChanged(change.value());
 
+        // The whole range at once, so listeners only have to redo things once for it
         for (auto& cb : on_undo) {
-            cb(item.pos);
+            cb(change->start, change->length);
         }
     } else {
         if (dialog) {
@@ -676,17 +1316,17 @@ void UIDisplay::undo (bool dialog) {
 }
 
 void UIDisplay::redo (bool dialog) {
-    HerixLib::RedoInfo info = hex.redo();
-    if (info.wasSuccess()) {
-        auto& item = info.undone.value();
-        sel_pos = item.pos;
+    std::optional<EditChange> change = hex.redo();
+    if (change.has_value()) {
+        sel_pos = change->start;
 
         if (dialog) {
-            setBarMessage("Redid " + std::to_string(item.data.size()) + " bytes.");
+            setBarMessage("Redid changes to " + std::to_string(change->length) + " bytes.");
         }
+        markChanged(change.value());
 
         for (auto& cb : on_redo) {
-            cb(item.pos);
+            cb(change->start, change->length);
         }
     } else {
         if (dialog) {
@@ -695,80 +1335,209 @@ void UIDisplay::redo (bool dialog) {
     }
 }
 
+void UIDisplay::markChanged (const EditChange& change) {
+    if (change.layout_changed) {
+        markLayoutChanged(change.start);
+    } else if (change.runs != nullptr) {
+        for (HerixLib::FilePosition pos : change.runs->positions) {
+            markModified(pos, change.runs->length);
+        }
+    } else {
+        markModified(change.start, change.length);
+    }
+}
+
+bool UIDisplay::insertBytes (HerixLib::FilePosition pos, std::vector<HerixLib::Byte> bytes) {
+    if (pos > getFileEnd() || bytes.empty()) {
+        return false;
+    }
+    hex.endEditSession();
+    hex.insert(pos, bytes);
+    hex.endEditSession();
+    markLayoutChanged(pos);
+    return true;
+}
+bool UIDisplay::fillRange (HerixLib::FilePosition pos, size_t length, std::vector<HerixLib::Byte> pattern) {
+    if (pos >= getFileEnd() || length == 0 || pattern.empty()) {
+        return false;
+    }
+    hex.fillRange(pos, length, pattern);
+    markModified(pos, length);
+    return true;
+}
+bool UIDisplay::pasteFromFile (std::string path, uint64_t source_offset, HerixLib::FilePosition pos, size_t length) {
+    if (pos >= getFileEnd() || length == 0) {
+        return false;
+    }
+    try {
+        hex.pasteFromFile(path, source_offset, pos, length);
+    } catch (const std::runtime_error& err) {
+        setBarMessage(std::string("Could not paste: ") + err.what());
+        return false;
+    }
+    markModified(pos, length);
+    return true;
+}
+bool UIDisplay::eraseBytes (HerixLib::FilePosition pos, size_t length) {
+    if (pos >= getFileEnd() || length == 0) {
+        return false;
+    }
+    hex.erase(pos, length);
+    markLayoutChanged(pos);
+    return true;
+}
+
 
 // == KEY HANDLING
 // TODO: make sure all key functions are registered with lua
 
+void UIDisplay::loadKeymap () {
+    sol::optional<sol::table> config = lua["keymap"];
+    if (!config) {
+        return;
+    }
+
+    for (auto& [name, value] : config.value()) {
+        std::optional<KeyAction> action = Keymap::parseAction(name.as<std::string>());
+        if (!action.has_value()) {
+            logAtExit("Unknown action in keymap: " + name.as<std::string>());
+            continue;
+        }
+
+        // Whatever is given replaces the default keys for the action
+        keymap.clear(action.value());
+        auto bindKey = [this, &action] (const sol::object& key_value) {
+            if (key_value.get_type() == sol::type::number) {
+                keymap.bind(action.value(), key_value.as<int>());
+                return;
+            }
+            std::optional<int> key_code = Keymap::parseKey(key_value.as<std::string>());
+            if (key_code.has_value()) {
+                keymap.bind(action.value(), key_code.value());
+            } else {
+                logAtExit("Unknown key in keymap: " + key_value.as<std::string>());
+            }
+        };
+        if (value.get_type() == sol::type::table) {
+            for (auto& [index, key_value] : value.as<sol::table>()) {
+                bindKey(key_value);
+            }
+        } else {
+            bindKey(value);
+        }
+    }
+}
+
 bool UIDisplay::isExitKey (int k) const {
-    return k == 'q' || k == 'Q';
+    return keymap.is(k, KeyAction::Exit);
 }
 bool UIDisplay::isYesKey (int k) const {
-    return k == 'y' || key == 'Y';
+    return keymap.is(k, KeyAction::Yes);
 }
 bool UIDisplay::isQuestionKey (int k) const {
-    return k == '?';
+    return keymap.is(k, KeyAction::Question);
 }
 bool UIDisplay::isUpArrow (int k) const {
     return k == KEY_UP;
 }
 bool UIDisplay::isUpKey (int k) const {
-    return isUpArrow(k) || k == 'k' || k == 'K';
+    return keymap.is(k, KeyAction::Up);
 }
 bool UIDisplay::isDownArrow (int k) const {
     return k == KEY_DOWN;
 }
 bool UIDisplay::isDownKey (int k) const {
-    return isDownArrow(k) || k == 'j' || k == 'J';
+    return keymap.is(k, KeyAction::Down);
 }
 bool UIDisplay::isLeftArrow(int k) const {
     return k == KEY_LEFT;
 }
 bool UIDisplay::isLeftKey (int k) const {
-    return isLeftArrow(k) || k == 'h' || k == 'H';
+    return keymap.is(k, KeyAction::Left);
 }
 bool UIDisplay::isRightArrow (int k) const {
     return k == KEY_RIGHT;
 }
 bool UIDisplay::isRightKey (int k) const {
-    return isRightArrow(k) || k == 'l' || k == 'L';
+    return keymap.is(k, KeyAction::Right);
 }
 
 bool UIDisplay::isEnterKey (int k) const {
-    return k == KEY_ENTER || k == '\n';
+    return keymap.is(k, KeyAction::Enter);
 }
 
 bool UIDisplay::isSaveKey (int k) const {
-    std::string key_name = std::string(keyname(k));
-    return key_name == "^s" || key_name == "^S"; // || k == 's' || k == 'S';
+    return keymap.is(k, KeyAction::Save);
 }
 
 bool UIDisplay::isEndOfFileKey (int k) const {
-    return k == 'g' || k == 'G';
+    return keymap.is(k, KeyAction::EndOfFile);
 }
 
 bool UIDisplay::isPageDownkey (int k) const {
-    return k == KEY_NPAGE;
+    return keymap.is(k, KeyAction::PageDown);
 }
 
 bool UIDisplay::isPageUpKey (int k) const {
-    return k == KEY_PPAGE;
+    return keymap.is(k, KeyAction::PageUp);
 }
 
 bool UIDisplay::isEndKey (int k) const {
-    return k == KEY_END || k == KEY_SEND;
+    return keymap.is(k, KeyAction::End);
 }
 
 bool UIDisplay::isHomeKey (int k) const {
-    return k == KEY_HOME || k == KEY_SHOME;
+    return keymap.is(k, KeyAction::Home);
 }
 
 bool UIDisplay::isUndoKey (int k) const {
-    std::string key_name = std::string(keyname(k));
-    return key_name == "u" || key_name == "U" || key_name == "^z" || key_name == "^Z";
+    return keymap.is(k, KeyAction::Undo);
 }
 bool UIDisplay::isRedoKey (int k) const {
-    std::string key_name = std::string(keyname(k));
-    return key_name == "r" || key_name == "R" || key_name == "^y" || key_name == "^Y";
+    return keymap.is(k, KeyAction::Redo);
+}
+
+bool UIDisplay::isStringsKey (int k) const {
+    return keymap.is(k, KeyAction::Strings);
+}
+
+bool UIDisplay::isMinimapKey (int k) const {
+    return keymap.is(k, KeyAction::Minimap);
+}
+
+bool UIDisplay::isZoomInKey (int k) const {
+    return keymap.is(k, KeyAction::ZoomIn);
+}
+
+bool UIDisplay::isZoomOutKey (int k) const {
+    return keymap.is(k, KeyAction::ZoomOut);
+}
+
+bool UIDisplay::isInspectorKey (int k) const {
+    return keymap.is(k, KeyAction::Inspector);
+}
+
+bool UIDisplay::isInsertModeKey (int k) const {
+    return keymap.is(k, KeyAction::InsertMode);
+}
+bool UIDisplay::isDeleteKey (int k) const {
+    return keymap.is(k, KeyAction::Delete);
+}
+bool UIDisplay::isBackspaceKey (int k) const {
+    return keymap.is(k, KeyAction::Backspace);
+}
+
+bool UIDisplay::isNextHunkKey (int k) const {
+    return keymap.is(k, KeyAction::NextHunk);
+}
+bool UIDisplay::isPreviousHunkKey (int k) const {
+    return keymap.is(k, KeyAction::PreviousHunk);
+}
+bool UIDisplay::isCommandKey (int k) const {
+    return keymap.is(k, KeyAction::Command);
+}
+bool UIDisplay::isFrameTimesKey (int k) const {
+    return keymap.is(k, KeyAction::FrameTimes);
 }
 
 // == EVENT HANDLING
@@ -776,8 +1545,39 @@ bool UIDisplay::isRedoKey (int k) const {
 KeyHandleFlags UIDisplay::handleKeyHandlers () {
     KeyHandleFlags key_handle;
 
-    for (std::pair<const unsigned int, sol::protected_function> handler : key_handlers) {
-        auto res = handler.second(key);
+    // The keys are text being typed into the bar, or the answer to its question, not for plugins
+    if (bar_asking != UIBarAsking::NONE) {
+        return key_handle;
+    }
+
+    // Plugins waiting on this key get loaded first, so that the handlers they register see it. Their keys are for
+    // the hex view, so the same key typed in another panel doesn't load them.
+    auto lazy = state == UIState::Hex ? lazy_key_plugins.find(key) : lazy_key_plugins.end();
+    if (lazy != lazy_key_plugins.end()) {
+        std::vector<size_t> waiting = std::move(lazy->second);
+        lazy_key_plugins.erase(lazy);
+        for (size_t index : waiting) {
+            activatePlugin(index);
+        }
+    }
+
+    key_handler_table.collect(key, static_cast<int>(state), static_cast<int>(hex_view_state), matched_key_handlers);
+
+    handling_keys = true;
+    // Run on the way out whether a handler failed or not, so the handlers removed meanwhile are always let go of
+    struct HandlingKeysScope {
+        UIDisplay& ui;
+        ~HandlingKeysScope () {
+            ui.finishHandlingKeys();
+        }
+    } handling_keys_scope{*this};
+    for (unsigned int id : matched_key_handlers) {
+        // Removed by a handler before it
+        if (!key_handler_table.contains(id)) {
+            continue;
+        }
+
+        auto res = key_handlers.at(id)(key);
         if (!res.valid()) {
             // TODO: this should probably be ignored most of the time
             sol::error err = res;
@@ -815,21 +1615,40 @@ KeyHandleFlags UIDisplay::handleKeyHandlers () {
     return key_handle;
 }
 
+void UIDisplay::finishHandlingKeys () {
+    handling_keys = false;
+    for (unsigned int id : removed_key_handlers) {
+        key_handlers.erase(id);
+    }
+    removed_key_handlers.clear();
+}
+
 void UIDisplay::handleInit () {
-    for (auto& item : on_init) {
-        item();
+    {
+        StartupPhase phase("init listeners");
+        for (auto& item : on_init) {
+            item();
+        }
     }
 
     // Clear on_init because it's never going to be called again.
     on_init.clear();
 
+    StartupPhase phase("first frame");
     handleDrawing();
 }
 
 void UIDisplay::handleEvent () {
-    KeyHandleFlags key_handle = handleKeyHandlers();
+    frame_times.beginFrame();
+
+    KeyHandleFlags key_handle;
+    {
+        FrameTimes::Scope timing(frame_times, FrameTimes::KEY_HANDLERS);
+        key_handle = handleKeyHandlers();
+    }
 
     if (key_handle.functional) {
+        FrameTimes::Scope timing(frame_times, FrameTimes::FUNCTIONAL);
         handleFunctional();
     }
 
@@ -838,11 +1657,183 @@ void UIDisplay::handleEvent () {
         handleSpecial();
     }
 
+    updateBackgroundWork();
+
     // Drawing
     if (key_handle.drawing) {
         handleDrawing();
     }
-    flushinp();
+
+    frame_times.endFrame();
+}
+
+void UIDisplay::handleResize () {
+    // SIGWINCH goes to the event loop rather than curses, so curses has to be told the new size
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) {
+        resizeterm(size.ws_row, size.ws_col);
+    }
+    key = KEY_RESIZE;
+    handleEvent();
+}
+
+void UIDisplay::handleIdle () {
+    frame_times.beginFrame();
+    bool drawn = false;
+    if (updateBackgroundWork()) {
+        if (state == UIState::Hex) {
+            drawView();
+            drawn = true;
+        } else if (state == UIState::Strings) {
+            drawStrings();
+            drawn = true;
+        } else if (state == UIState::Info) {
+            drawInfo();
+            drawn = true;
+        }
+    }
+    // Progress messages
+    if (!bar_message.empty()) {
+        drawBar();
+        drawn = true;
+    }
+    if (drawn && frame_times_visible) {
+        drawFrameTimes();
+    }
+    frame_times.endFrame();
+}
+
+void UIDisplay::reportFrameTimes () {
+    if (!lua.get_or("frame_times", false)) {
+        return;
+    }
+    for (const std::string& line : frame_times.getReport()) {
+        logAtExit(line);
+    }
+}
+
+bool UIDisplay::hasPendingWork () const {
+    return (file_summary && file_summary->hasPendingWork()) || (diff && !diff->isDone()) || replace_all || string_scan || file_hash ||
+        file_stats_task;
+}
+
+int UIDisplay::getIdleTimeout () const {
+    if (replace_all || file_hash || file_stats_task) {
+        // Searching, hashing and counting happen on this thread in small steps, so keep going as long as no key is pressed
+        return 0;
+    }
+    // Workers wake the loop up when they finish, this is only so that their progress gets drawn
+    return hasPendingWork() ? 100 : -1;
+}
+
+void UIDisplay::wakeFromWorker () {
+    // Nothing to do in the job itself, handleIdle takes in the results after the loop wakes up
+    events.post([] () {});
+}
+
+bool UIDisplay::updateBackgroundWork () {
+    bool changed = false;
+    if (file_summary) {
+        // Dirty blocks are read through Herix on this thread, so only do a few at a time.
+        changed = file_summary->update(hex, 4);
+    }
+    if (diff) {
+        changed = diff->update() || changed;
+    }
+    if (string_scan) {
+        if (string_scan->update(hex)) {
+            finishStrings();
+            changed = true;
+        } else {
+            HerixLib::FilePosition size = std::max<HerixLib::FilePosition>(string_scan->getSize(), 1);
+            setBarMessage("Scanning for strings: " + std::to_string((string_scan->getProgress() * 100) / size) + "%");
+        }
+    }
+
+    if (replace_all) {
+        if (replace_all->version != hex.getVersion()) {
+            replace_all.reset();
+            setBarMessage("Replace cancelled, the file was edited while searching.");
+            return changed;
+        }
+
+        // Stop after a little while, so keys still get handled promptly
+        auto start_time = std::chrono::steady_clock::now();
+        while (!replace_all->search.isDone() && std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(30)) {
+            replace_all->search.step(hex, 4 * 1024 * 1024, replace_all->matches);
+        }
+
+        if (replace_all->search.isDone()) {
+            size_t count = replace_all->matches.size();
+            for (HerixLib::FilePosition pos : replace_all->matches) {
+                markModified(pos, replace_all->replacement.size());
+            }
+            hex.replaceRuns(std::move(replace_all->matches), std::move(replace_all->replacement));
+            replace_all.reset();
+            setBarMessage("Replaced " + std::to_string(count) + " occurrences.");
+            changed = true;
+        } else {
+            size_t file_end = std::max<size_t>(getFileEnd(), 1);
+            setBarMessage("Replacing: " + std::to_string((replace_all->search.getPosition() * 100) / file_end) + "% (" +
+                std::to_string(replace_all->matches.size()) + " found)");
+        }
+    }
+
+    if (file_hash) {
+        if (file_hash->version != hex.getVersion()) {
+            // The note starts it over when it's refreshed
+            file_hash.reset();
+            return refreshInformation() || changed;
+        }
+
+        auto start_time = std::chrono::steady_clock::now();
+        while (!file_hash->hash.isDone() && std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(30)) {
+            file_hash->hash.step(hex, 4 * 1024 * 1024);
+        }
+
+        if (file_hash->hash.isDone()) {
+            if (file_hashes_version != file_hash->version) {
+                file_hashes.clear();
+                file_hashes_version = file_hash->version;
+            }
+            const std::vector<std::string>& digests = file_hash->hash.getDigests();
+            for (size_t i = 0; i < digests.size(); i++) {
+                file_hashes[file_hash->names.at(i)] = digests[i];
+            }
+            file_hash.reset();
+            changed = refreshInformation() || changed;
+        } else {
+            size_t length = std::max<size_t>(file_hash->hash.getLength(), 1);
+            setBarMessage("Hashing: " + std::to_string((file_hash->hash.getProgress() * 100) / length) + "%");
+        }
+    }
+
+    if (file_stats_task) {
+        if (file_stats_task->version != hex.getVersion()) {
+            file_stats_task.reset();
+            return refreshInformation() || changed;
+        }
+
+        bool done = false;
+        auto start_time = std::chrono::steady_clock::now();
+        while (!done && std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(30)) {
+            RangeStats piece = computeRangeStats(hex, file_stats_task->position, 4 * 1024 * 1024);
+            file_stats_task->stats.append(piece);
+            file_stats_task->position += piece.total;
+            done = piece.total == 0 || file_stats_task->position >= getFileEnd();
+        }
+
+        if (done) {
+            file_stats = std::move(file_stats_task->stats);
+            file_stats_version = file_stats_task->version;
+            file_stats_task.reset();
+            changed = refreshInformation() || changed;
+        } else {
+            size_t file_end = std::max<size_t>(getFileEnd(), 1);
+            setBarMessage("Counting: " + std::to_string((file_stats_task->position * 100) / file_end) + "%");
+        }
+    }
+    return changed;
 }
 
 void UIDisplay::handleDownKeyMovement () {
@@ -917,6 +1908,195 @@ void UIDisplay::handleJumpEndOfFile () {
     sel_pos = getFileEnd() - 1;
 }
 
+void UIDisplay::handleJumpToPosition (HerixLib::FilePosition pos) {
+    HerixLib::FilePosition hex_byte_width = static_cast<HerixLib::FilePosition>(view.getHexByteWidth());
+    size_t file_end = getFileEnd();
+    if (file_end == 0 || hex_byte_width == 0) {
+        return;
+    }
+
+    if (pos >= file_end) {
+        pos = file_end - 1;
+    }
+
+    row_pos = pos / hex_byte_width;
+    sel_pos = row_pos * hex_byte_width;
+}
+
+void UIDisplay::handleJumpToHunk (bool forward) {
+    if (!diff) {
+        return;
+    }
+
+    const std::vector<DiffHunk>& hunks = diff->getHunks();
+    size_t index = diff->findHunkA(sel_pos);
+    // findHunkA gives the hunk the cursor is in (or the one after), so step off of it in the direction we're going
+    if (forward) {
+        if (index < hunks.size() && hunks[index].a_start <= sel_pos) {
+            index++;
+        }
+    } else {
+        index = index == 0 ? hunks.size() : index - 1;
+    }
+
+    std::string progress = "";
+    if (!diff->isDone()) {
+        size_t size = std::max<size_t>(diff->getSizeA(), 1);
+        progress = " (comparing, " + std::to_string(diff->getProgress() * 100 / size) + "%)";
+    }
+
+    if (index >= hunks.size()) {
+        setBarMessage(std::string(forward ? "No more differences" : "No earlier differences") + progress);
+        return;
+    }
+
+    const DiffHunk& hunk = hunks[index];
+    handleJumpToPosition(hunk.a_start);
+    sel_pos = std::min(hunk.a_start, getFileEnd() > 0 ? getFileEnd() - 1 : 0);
+    setBarMessage("Difference " + std::to_string(index + 1) + "/" + std::to_string(hunks.size()) +
+        ": 0x" + numberToHex(hunk.a_start, 1) + " +" + std::to_string(hunk.a_length) +
+        " -> 0x" + numberToHex(hunk.b_start, 1) + " +" + std::to_string(hunk.b_length) + progress);
+}
+
+bool UIDisplay::handleCountedMotion () {
+    if (key >= '0' && key <= '9' && (key != '0' || motion_count != 0)) {
+        // Past the limit further digits are ignored, it's already more than any file has rows
+        if (motion_count < MAX_MOTION_COUNT) {
+            motion_count = motion_count * 10 + static_cast<size_t>(key - '0');
+        }
+        setBarMessage(std::to_string(motion_count));
+        return true;
+    }
+    if (motion_count == 0) {
+        return false;
+    }
+
+    // Any other key drops the count
+    size_t count = std::exchange(motion_count, 0);
+    if (!isDownKey(key) && !isUpKey(key) && !isRightKey(key) && !isLeftKey(key) && !isPageDownkey(key) && !isPageUpKey(key)) {
+        return false;
+    }
+
+    HerixLib::FilePosition old_row_pos = row_pos;
+    handleCountedMovement(count);
+    updateRowPosition();
+    prefetchView(old_row_pos);
+    return true;
+}
+
+void UIDisplay::handleCountedMovement (size_t count) {
+    HerixLib::FilePosition byte_count = static_cast<HerixLib::FilePosition>(view.getHexByteWidth());
+    HerixLib::FilePosition page_size = byte_count * static_cast<HerixLib::FilePosition>(view.getHexHeight());
+    size_t file_end = getFileEnd();
+    if (file_end == 0 || byte_count == 0) {
+        return;
+    }
+    HerixLib::FilePosition last = file_end - 1;
+
+    // Each is what count presses of the key would do, as far as it can go
+    if (isDownKey(key)) {
+        sel_pos += std::min<HerixLib::FilePosition>(count, (last - sel_pos) / byte_count) * byte_count;
+    } else if (isUpKey(key)) {
+        sel_pos -= std::min<HerixLib::FilePosition>(count, sel_pos / byte_count) * byte_count;
+    } else if (isRightKey(key)) {
+        sel_pos += std::min<HerixLib::FilePosition>(count, last - sel_pos);
+    } else if (isLeftKey(key)) {
+        sel_pos -= std::min<HerixLib::FilePosition>(count, sel_pos);
+    } else if (isPageDownkey(key)) {
+        if (page_size != 0 && count < (file_end - sel_pos + page_size - 1) / page_size) {
+            // Same as handlePageDownMovement, which leaves the cursor on the top row
+            sel_pos += page_size * (count + 1);
+            updateRowPosition();
+            sel_pos -= page_size;
+        } else {
+            handleJumpEndOfFile();
+        }
+    } else if (isPageUpKey(key)) {
+        sel_pos -= std::min<HerixLib::FilePosition>(count * page_size, sel_pos);
+    }
+}
+
+void UIDisplay::prefetchView (HerixLib::FilePosition old_row_pos) {
+    HerixLib::FilePosition rows = static_cast<HerixLib::FilePosition>(view.getHexHeight());
+    HerixLib::FilePosition distance = row_pos > old_row_pos ? row_pos - old_row_pos : old_row_pos - row_pos;
+    // Nearby pages were likely read recently anyway
+    if (distance > rows * 2) {
+        hex.prefetch(getRowOffset(), static_cast<size_t>(view.getHexByteWidth()) * static_cast<size_t>(rows));
+    }
+}
+
+void UIDisplay::handleCommandInput () {
+    if (key == 27) {
+        bar_asking = UIBarAsking::NONE;
+    } else if (isEnterKey(key)) {
+        bar_asking = UIBarAsking::NONE;
+        runCommand(bar_input);
+    } else if (isBackspaceKey(key)) {
+        if (bar_input.empty()) {
+            bar_asking = UIBarAsking::NONE;
+        } else {
+            bar_input.pop_back();
+        }
+    } else if (isDisplayableCharacter(key)) {
+        bar_input.push_back(static_cast<char>(key));
+    }
+}
+
+void UIDisplay::runCommand (const std::string& command) {
+    size_t split = command.find(' ');
+    std::string name = command.substr(0, split);
+    std::string argument = split == std::string::npos ? "" : command.substr(split + 1);
+
+    if (name == "goto" || name == "g") {
+        std::optional<HerixLib::FilePosition> target = parseGotoTarget(argument);
+        HerixLib::FilePosition byte_count = static_cast<HerixLib::FilePosition>(view.getHexByteWidth());
+        size_t file_end = getFileEnd();
+        if (!target.has_value()) {
+            setBarMessage("Expected a position like 0x1f00, 7936 or 50%.");
+        } else if (file_end != 0 && byte_count != 0) {
+            HerixLib::FilePosition old_row_pos = row_pos;
+            sel_pos = std::min<HerixLib::FilePosition>(target.value(), file_end - 1);
+            row_pos = sel_pos / byte_count;
+            editing_position = false;
+            prefetchView(old_row_pos);
+            setBarMessage("0x" + numberToHex(sel_pos, 1));
+        }
+    } else if (!name.empty()) {
+        setBarMessage("Unknown command: " + name);
+    }
+}
+
+std::optional<HerixLib::FilePosition> UIDisplay::parseGotoTarget (const std::string& target) {
+    if (target.empty()) {
+        return std::nullopt;
+    }
+
+    if (target.back() == '%') {
+        char* end = nullptr;
+        std::string number = target.substr(0, target.size() - 1);
+        double percent = std::strtod(number.c_str(), &end);
+        if (number.empty() || end != number.c_str() + number.size() || !(percent >= 0.0 && percent <= 100.0)) {
+            return std::nullopt;
+        }
+        size_t last = getFileEnd() > 0 ? getFileEnd() - 1 : 0;
+        return static_cast<HerixLib::FilePosition>(static_cast<double>(last) * (percent / 100.0));
+    }
+
+    if (target.size() > 2 && target[0] == '0' && (target[1] == 'x' || target[1] == 'X')) {
+        std::string digits = target.substr(2);
+        // Anything longer can't fit
+        if (digits.size() > 16 || !std::all_of(digits.begin(), digits.end(), [] (char c) { return isHexadecimalCharacter(c); })) {
+            return std::nullopt;
+        }
+        return hexToNumber<HerixLib::FilePosition>(digits);
+    }
+
+    if (target.size() > 19 || !std::all_of(target.begin(), target.end(), [] (char c) { return c >= '0' && c <= '9'; })) {
+        return std::nullopt;
+    }
+    return decToNumber<HerixLib::FilePosition>(target);
+}
+
 void UIDisplay::handleJumpEndOfLine () {
     HerixLib::FilePosition hex_byte_width = static_cast<HerixLib::FilePosition>(view.getHexByteWidth());
 
@@ -989,16 +2169,36 @@ void UIDisplay::handleFunctionalHex () {
         }
     } else if (bar_asking == UIBarAsking::ShouldSave) {
         if (isYesKey(key)) {
-            saveFile();
+            // Before saving, so that the result can be shown in the bar
             bar_asking = UIBarAsking::NONE;
+            saveFile();
         } else if (isDisplayableCharacter(key)) {
             bar_asking = UIBarAsking::NONE;
         }
+    } else if (bar_asking == UIBarAsking::Command) {
+        handleCommandInput();
+        updateRowPosition();
+    } else if (key == KEY_MOUSE) {
+        handleMouse();
+    } else if (minimap.has_value() && minimap->focused) {
+        handleFunctionalMinimap();
     } else if (hex_view_state == HexViewState::Editing) {
         if (isEnterKey(key) || isExitKey(key)) {
-            hex_view_state = HexViewState::Default;
+            setHexViewState(HexViewState::Default);
             // Reset back to 0.
             editing_position = false;
+        } else if (isInsertModeKey(key)) {
+            insert_mode = !insert_mode;
+            hex.endEditSession();
+            setBarMessage(insert_mode ? "Insert mode." : "Overwrite mode.");
+        } else if (isDeleteKey(key)) {
+            eraseBytes(sel_pos, 1);
+            editing_position = false;
+        } else if (isBackspaceKey(key)) {
+            if (sel_pos > 0 && eraseBytes(sel_pos - 1, 1)) {
+                sel_pos--;
+            }
+            editing_position = false;
         } else if (isQuestionKey(key)) {
             state = UIState::InfoAsking;
             information_selected = 0;
@@ -1015,6 +2215,12 @@ void UIDisplay::handleFunctionalHex () {
             handlePageDownMovement();
         } else if (isPageUpKey(key)) {
             handlePageUpMovement();
+        } else if (isHexadecimalCharacter(key) && insert_mode && editing_position == false) {
+            // In insert mode the first nibble inserts a new byte, which the second one then edits
+            HerixLib::Byte hex_num = hexChrToNumber(static_cast<char>(std::toupper(key)));
+            hex.insert(sel_pos, {setHighestHalfByte(0, hex_num)});
+            markLayoutChanged(sel_pos);
+            editing_position = true;
         } else if (isHexadecimalCharacter(key)) {
             char hex_char = static_cast<char>(std::toupper(key));
             HerixLib::Byte hex_num = hexChrToNumber(hex_char);
@@ -1030,6 +2236,7 @@ void UIDisplay::handleFunctionalHex () {
                 }
 
                 hex.edit(sel_pos, value);
+                markModified(sel_pos, 1);
                 if (getShouldEditMoveForward()) {
                     handleRightKeyEditingMovement();
                 }
@@ -1050,6 +2257,10 @@ void UIDisplay::handleFunctionalHex () {
 
         updateRowPosition();
     } else if (hex_view_state == HexViewState::Default) {
+        if (handleCountedMotion()) {
+            return;
+        }
+
         if (isExitKey(key)) {
             bar_asking = UIBarAsking::ShouldExit;
         } else if (isQuestionKey(key)) {
@@ -1069,7 +2280,7 @@ void UIDisplay::handleFunctionalHex () {
         } else if (isPageUpKey(key)) {
             handlePageUpMovement();
         } else if (isEnterKey(key)) {
-            hex_view_state = HexViewState::Editing;
+            setHexViewState(HexViewState::Editing);
         } else if (isSaveKey(key)) {
             handleSave();
         } else if (isEndOfFileKey(key)) {
@@ -1082,12 +2293,75 @@ void UIDisplay::handleFunctionalHex () {
             undo(true);
         } else if (isRedoKey(key)) {
             redo(true);
+        } else if (isStringsKey(key)) {
+            openStrings();
+            return;
+        } else if (isInspectorKey(key) && inspector.has_value()) {
+            SubView& sub_view = getSubView(inspector->sub_view_id);
+            sub_view.setVisible(!sub_view.getVisible());
+        } else if (isNextHunkKey(key) && diff) {
+            handleJumpToHunk(true);
+        } else if (isPreviousHunkKey(key) && diff) {
+            handleJumpToHunk(false);
+        } else if (isCommandKey(key)) {
+            bar_asking = UIBarAsking::Command;
+            bar_input.clear();
+        } else if (isFrameTimesKey(key)) {
+            frame_times_visible = !frame_times_visible;
+        } else if (isMinimapKey(key) && minimap.has_value()) {
+            minimap->focused = true;
+            setBarMessage("Minimap: up/down to move, +/- to zoom, m to leave.");
         }
 
         updateRowPosition();
     }
 }
 
+void UIDisplay::handleFunctionalMinimap () {
+    size_t height = static_cast<size_t>(std::max(view.getHexHeight(), 1));
+    HerixLib::FilePosition view_start = getRowOffset();
+    auto [window_start, window_end] = minimap->getWindow(*file_summary, view_start, height);
+    // How much of the file a single row of the minimap covers
+    HerixLib::FilePosition row_span = std::max<HerixLib::FilePosition>((window_end - window_start) / height, 1);
+
+    if (isMinimapKey(key) || isExitKey(key) || isEnterKey(key)) {
+        minimap->focused = false;
+        return;
+    } else if (isDownKey(key)) {
+        handleJumpToPosition(view_start + row_span);
+    } else if (isUpKey(key)) {
+        handleJumpToPosition(view_start > row_span ? view_start - row_span : 0);
+    } else if (isPageDownkey(key)) {
+        handleJumpToPosition(view_start + row_span * (height / 2));
+    } else if (isPageUpKey(key)) {
+        HerixLib::FilePosition span = row_span * (height / 2);
+        handleJumpToPosition(view_start > span ? view_start - span : 0);
+    } else if (isZoomInKey(key)) {
+        minimap->zoomIn(*file_summary, height);
+    } else if (isZoomOutKey(key)) {
+        minimap->zoomOut();
+    }
+
+    setBarMessage("Minimap: zoom " + std::to_string(minimap->zoom) + ", " + numberToHex(getRowOffset(), 8));
+}
+
+void UIDisplay::handleMouse () {
+    MEVENT event;
+    if (getmouse(&event) != OK) {
+        return;
+    }
+
+    if (minimap.has_value()) {
+        SubView& sv = getSubView(minimap->sub_view_id);
+        int x = event.x - view.x;
+        int y = event.y - view.y;
+        if (sv.getVisible() && x >= sv.getViewX() && x < sv.getViewX() + sv.getWidth() && y >= 0 && y < sv.getHeight()) {
+            size_t height = static_cast<size_t>(std::max(sv.getHeight(), 1));
+            handleJumpToPosition(minimap->getRowStart(*file_summary, getRowOffset(), height, static_cast<size_t>(y)));
+        }
+    }
+}
+
 void UIDisplay::handleFunctionalInfoAsking () {
     if (isExitKey(key)) {
             state = UIState::Hex;
@@ -1108,9 +2382,14 @@ void UIDisplay::handleFunctionalInfoAsking () {
         }
     } else if (isEnterKey(key)) {
         if (information_selected < information_notes.size()) {
+            std::optional<size_t> lazy_plugin = information_notes.at(information_selected).lazy_plugin;
+            if (lazy_plugin.has_value()) {
+                activatePlugin(lazy_plugin.value());
+            }
+
             state = UIState::Info;
             information_row_pos = 0;
-            current_information_text = information_notes.at(information_selected).text_func();
+            refreshInformation();
         }
     }
 
@@ -1118,6 +2397,20 @@ void UIDisplay::handleFunctionalInfoAsking () {
     information_row_pos = information_selected;
 }
 
+bool UIDisplay::refreshInformation () {
+    if (state != UIState::Info || information_selected >= information_notes.size()) {
+        return false;
+    }
+
+    const InformationNote& note = information_notes.at(information_selected);
+    if (note.lazy_plugin.has_value()) {
+        current_information_text = "The plugin for this never registered it.";
+    } else {
+        current_information_text = note.text_func();
+    }
+    return true;
+}
+
 void UIDisplay::handleFunctionalInfo () {
     if (isExitKey(key)) {
         state = UIState::Hex;
@@ -1130,6 +2423,92 @@ void UIDisplay::handleFunctionalInfo () {
     }
 }
 
+void UIDisplay::openStrings () {
+    StringExtractOptions options;
+    options.min_length = lua.get_or("strings_min_length", options.min_length);
+    options.utf16le = lua.get_or("strings_utf16le", options.utf16le);
+
+    // Scanned in the background, the panel stays empty until it is done
+    std::vector<StringHit>().swap(string_hits);
+    string_selected = 0;
+    string_row_pos = 0;
+    string_scan = std::make_unique<StringScanTask>(0, getFileEnd(), options, [this] () { wakeFromWorker(); });
+    state = UIState::Strings;
+    setBarMessage("Scanning for strings: 0%");
+    string_scan->update(hex);
+}
+
+void UIDisplay::finishStrings () {
+    string_hits = string_scan->takeHits();
+    string_scan.reset();
+
+    if (string_hits.empty()) {
+        closeStrings();
+        setBarMessage("No strings found.");
+        return;
+    }
+
+    // Start on the first string at or after the cursor.
+    auto after = std::lower_bound(string_hits.begin(), string_hits.end(), sel_pos,
+        [] (const StringHit& hit, HerixLib::FilePosition pos) {
+            return hit.offset < pos;
+        }
+    );
+    string_selected = std::min(static_cast<size_t>(after - string_hits.begin()), string_hits.size() - 1);
+    string_row_pos = string_selected;
+
+    setBarMessage("Found " + std::to_string(string_hits.size()) + " strings.");
+}
+
+void UIDisplay::closeStrings () {
+    state = UIState::Hex;
+    if (string_scan) {
+        // Stops the worker, throwing away what it found so far
+        string_scan.reset();
+        setBarMessage("Strings scan cancelled.");
+    }
+    // Swap rather than clear, so the memory is actually given back
+    std::vector<StringHit>().swap(string_hits);
+}
+
+void UIDisplay::handleFunctionalStrings () {
+    size_t page_size = static_cast<size_t>(std::max(view.height, 1));
+
+    if (isExitKey(key)) {
+        closeStrings();
+        return;
+    } else if (string_scan) {
+        // Nothing to move through until the scan is done
+        return;
+    } else if (isDownKey(key)) {
+        if (string_selected + 1 < string_hits.size()) {
+            string_selected++;
+        }
+    } else if (isUpKey(key)) {
+        if (string_selected > 0) {
+            string_selected--;
+        }
+    } else if (isPageDownkey(key)) {
+        string_selected = std::min(string_selected + page_size, string_hits.size() - 1);
+    } else if (isPageUpKey(key)) {
+        string_selected -= std::min(string_selected, page_size);
+    } else if (isEnterKey(key)) {
+        sel_pos = string_hits.at(string_selected).offset;
+        editing_position = false;
+        // Put the string at the top of the screen
+        row_pos = getSelectedRow();
+        closeStrings();
+        return;
+    }
+
+    // Keep the selection on screen
+    if (string_selected < string_row_pos) {
+        string_row_pos = string_selected;
+    } else if (string_selected >= string_row_pos + page_size) {
+        string_row_pos = string_selected + 1 - page_size;
+    }
+}
+
 void UIDisplay::handleFunctional () {
     if (state == UIState::Default) {
         handleFunctionalDefault();
@@ -1139,6 +2518,8 @@ void UIDisplay::handleFunctional () {
         handleFunctionalInfoAsking();
     } else if (state == UIState::Info) {
         handleFunctionalInfo();
+    } else if (state == UIState::Strings) {
+        handleFunctionalStrings();
     }
 }
 
@@ -1158,14 +2539,67 @@ void UIDisplay::handleDrawing () {
     } else if (state == UIState::Info) {
         drawInfo();
         drawBar();
+    } else if (state == UIState::Strings) {
+        drawStrings();
+        drawBar();
     } else if (state == UIState::Hex) {
         drawView();
         drawBar();
     }
+
+    if (frame_times_visible) {
+        drawFrameTimes();
+    }
+}
+
+void UIDisplay::drawFrameTimes () {
+    std::vector<FrameTimes::Summary> summaries = frame_times.summarize();
+    constexpr int WIDTH = 56;
+    int height = static_cast<int>(summaries.size()) + 2;
+    int x = std::max(view.width - WIDTH, 0);
+    if (height > view.height) {
+        height = view.height;
+    }
+    if (height <= 0) {
+        return;
+    }
+
+    // Made for each frame, since what's under it is drawn over anyway. That includes the inspector, which would
+    // otherwise keep what it last drew.
+    inspector_area = std::nullopt;
+    WINDOW* win = newwin(height, std::min(WIDTH, view.width), view.y, x);
+    if (win == nullptr) {
+        return;
+    }
+    werase(win);
+    box(win, 0, 0);
+    mvwprintw(win, 0, 2, " Frame times (ms): last p50 p95 p99 ");
+    for (int row = 1; row < height - 1; row++) {
+        const FrameTimes::Summary& summary = summaries[static_cast<size_t>(row - 1)];
+        mvwprintw(win, row, 1, "%-18.18s %7.2f %7.2f %7.2f %7.2f", summary.name.c_str(),
+            summary.last_ms, summary.p50_ms, summary.p95_ms, summary.p99_ms);
+    }
+    wrefresh(win);
+    delwin(win);
+}
+
+const std::pair<FrameTimes::StageID, FrameTimes::StageID>& UIDisplay::getSubViewStages (size_t id) {
+    while (sub_view_stages.size() <= id) {
+        size_t index = sub_view_stages.size();
+        std::string name = view.sub_views.at(index).getName();
+        if (name.empty()) {
+            name = "view " + std::to_string(index);
+        }
+        FrameTimes::StageID render = frame_times.addStage("render " + name);
+        FrameTimes::StageID resize = frame_times.addStage("resize " + name);
+        sub_view_stages.emplace_back(render, resize);
+    }
+    return sub_view_stages[id];
 }
 
 void UIDisplay::drawInfoAsking () {
     werase(view.win);
+    inspector_area = std::nullopt;
 
     for (size_t i = information_row_pos; i < std::min(information_row_pos+static_cast<size_t>(view.height), information_notes.size()); i++) {
         const InformationNote& item = information_notes.at(i);
@@ -1187,13 +2621,65 @@ void UIDisplay::drawInfoAsking () {
 
 void UIDisplay::drawInfo () {
     werase(view.win);
+    inspector_area = std::nullopt;
+
+    // Wrapped at the width of the view, and at newlines, so that notes can be laid out as lines.
+    size_t width = static_cast<size_t>(std::max(view.width, 1));
+    size_t line = 0;
+    size_t column = 0;
+    for (char ch : current_information_text) {
+        if (ch == '\n' || column == width) {
+            line++;
+            column = 0;
+            if (line >= information_row_pos && line - information_row_pos >= static_cast<size_t>(view.height)) {
+                break;
+            }
+            if (ch == '\n') {
+                continue;
+            }
+        }
+
+        if (line >= information_row_pos) {
+            view.move(static_cast<int>(column), static_cast<int>(line - information_row_pos));
+            if (isDisplayableCharacter(ch)) {
+                waddch(view.win, static_cast<unsigned int>(ch));
+            } else {
+                waddch(view.win, static_cast<unsigned int>('?'));
+            }
+        }
+        column++;
+    }
+
+    wrefresh(view.win);
+}
+
+void UIDisplay::drawStrings () {
+    werase(view.win);
+    inspector_area = std::nullopt;
+
+    size_t width = static_cast<size_t>(std::max(view.width, 0));
+    size_t end = std::min(string_row_pos + static_cast<size_t>(std::max(view.height, 0)), string_hits.size());
+    for (size_t i = string_row_pos; i < end; i++) {
+        const StringHit& hit = string_hits.at(i);
+        size_t unit = hit.encoding == StringEncoding::UTF16LE ? 2 : 1;
+
+        std::string line = numberToHex(hit.offset, 8);
+        line += hit.encoding == StringEncoding::UTF16LE ? " W " : " A ";
+
+        // Only read as much of the string as can fit on the line
+        size_t characters = std::min(hit.length / unit, width > line.size() ? width - line.size() : 0);
+        std::vector<HerixLib::Byte> data = hex.readMultipleCutoff(hit.offset, characters * unit);
+        for (size_t j = 0; j + unit <= data.size(); j += unit) {
+            line += isDisplayableCharacter(data[j]) ? static_cast<char>(data[j]) : ' ';
+        }
 
-    for (size_t i = information_row_pos*static_cast<size_t>(view.width); i < current_information_text.size(); i++) {
-        char ch = current_information_text[i];
-        if (isDisplayableCharacter(ch)) {
-            waddch(view.win, static_cast<unsigned int>(ch));
-        } else {
-            waddch(view.win, static_cast<unsigned int>('?'));
+        view.move(0, static_cast<int>(i - string_row_pos));
+        if (string_selected == i) {
+            wattron(view.win, WA_STANDOUT);
+        }
+        view.print(line, 0, false);
+        if (string_selected == i) {
+            wattroff(view.win, WA_STANDOUT);
         }
     }
 
@@ -1,17 +1,82 @@
 #ifndef FILE_SEEN_UIDISPLAY
 #define FILE_SEEN_UIDISPLAY
 
+#include <array>
 #include <string>
+#include <memory>
+#include <unordered_map>
 #include "./mutil.hpp"
 #include "./window.hpp"
 #include "./subview.hpp"
+#include "./stringextract.hpp"
+#include "./filesummary.hpp"
+#include "./minimapview.hpp"
+#include "./inspectorview.hpp"
+#include "./hashing.hpp"
+#include "./histogram.hpp"
+#include "./diffengine.hpp"
+#include "./editlayer.hpp"
+#include "./search.hpp"
+#include "./eventloop.hpp"
+#include "./keyhandlers.hpp"
+#include "./keymap.hpp"
+#include "./scriptcache.hpp"
+#include "./fileprimer.hpp"
+#include "./luasandbox.hpp"
+#include "./frametimes.hpp"
 
 struct InformationNote {
     std::string name;
     sol::protected_function text_func;
+    // Index into lazy_plugins of the plugin which will register it, while that isn't loaded yet
+    std::optional<size_t> lazy_plugin;
 
     InformationNote (std::string t_name, sol::protected_function t_text_func) :
         name(t_name), text_func(t_text_func) {}
+    InformationNote (std::string t_name, size_t t_lazy_plugin) :
+        name(t_name), lazy_plugin(t_lazy_plugin) {}
+};
+
+// A plugin from the plugins list which is only loaded once one of its triggers happens
+struct LazyPlugin {
+    std::string path;
+    // Libraries it's granted past the minimal profile
+    std::vector<std::string> libraries;
+    bool loaded = false;
+};
+
+// A replace-all which is still searching. The matches are only turned into an edit once the whole file has been
+// searched, so that it is a single undo step.
+struct ReplaceAllTask {
+    StreamingSearch search;
+    std::vector<HerixLib::Byte> replacement;
+    std::vector<HerixLib::FilePosition> matches;
+    // The contents it was started on, if they change the matches found so far can't be trusted
+    uint64_t version;
+
+    ReplaceAllTask (std::vector<HerixLib::Byte> t_find, std::vector<HerixLib::Byte> t_replacement, uint64_t t_version) :
+        search(t_find), replacement(t_replacement), version(t_version) {}
+};
+
+// Hashes of the whole file for fileHashes(), computed a piece at a time in the idle loop
+struct FileHashTask {
+    std::vector<std::string> names;
+    StreamingHash hash;
+    // The contents it was started on, the digests are worthless if they change
+    uint64_t version;
+
+    FileHashTask (std::vector<std::string> t_names, StreamingHash t_hash, uint64_t t_version) :
+        names(t_names), hash(t_hash), version(t_version) {}
+};
+
+// Stats of the whole file for fileStats(), counted a piece at a time in the idle loop
+struct FileStatsTask {
+    RangeStats stats;
+    // Everything before this has been counted
+    HerixLib::FilePosition position = 0;
+    uint64_t version;
+
+    explicit FileStatsTask (uint64_t t_version) : version(t_version) {}
 };
 
 class UIDisplay {
@@ -20,18 +85,31 @@ class UIDisplay {
     inline static const std::string DEFAULT_CONFIG =
     "plugins = {"
         "PLUGIN_DIR .. \"/AsciiView.lua\","
+        "PLUGIN_DIR .. \"/EntropyView.lua\","
+        "PLUGIN_DIR .. \"/Minimap.lua\","
+        "PLUGIN_DIR .. \"/DataInspector.lua\","
         "PLUGIN_DIR .. \"/Offsets.lua\","
         "PLUGIN_DIR .. \"/BaseHighlighter.lua\","
         "PLUGIN_DIR .. \"/FileHighlighter.lua\","
-        "PLUGIN_DIR .. \"/FileHighlighter_ELF.lua\","
-        "PLUGIN_DIR .. \"/FileHighlighter_PNG.lua\","
-        "PLUGIN_DIR .. \"/FileHighlighter_GIF.lua\","
-        "PLUGIN_DIR .. \"/HexWrite.lua\""
+        "{path = PLUGIN_DIR .. \"/FileHighlighter_ELF.lua\", magic = \"\\127ELF\"},"
+        "{path = PLUGIN_DIR .. \"/FileHighlighter_PNG.lua\", magic = \"\\137PNG\"},"
+        "{path = PLUGIN_DIR .. \"/FileHighlighter_GIF.lua\", magic = \"GIF8\"},"
+        "PLUGIN_DIR .. \"/DiffHighlighter.lua\","
+        "PLUGIN_DIR .. \"/HexWrite.lua\","
+        "{path = PLUGIN_DIR .. \"/Hashes.lua\", info = \"Hashes\"},"
+        "{path = PLUGIN_DIR .. \"/RangeStats.lua\", info = \"Statistics\"},"
+        "{path = PLUGIN_DIR .. \"/BlockEdit.lua\", keys = {\"f\", \"p\"}}"
     "}";
 
     public:
     // Should be first, so it is destructed before anything that uses lua-things
     sol::state lua;
+    // After lua, since timers hold lua callbacks, but before anything with a worker thread, since workers post to it
+    EventLoop events;
+    // Compiled lua files from previous starts
+    ScriptCache script_cache;
+    // Which libraries are opened, and what plugins get to see of them
+    LuaSandbox lua_libraries;
 
     UIState state = UIState::Default;
     HexViewState hex_view_state = HexViewState::Default;
@@ -59,23 +137,82 @@ class UIDisplay {
 
     // Current id, used for key_handlers
     unsigned int key_handler_id = 0;
-    // pair<id, handler>
-    std::vector<std::pair<unsigned int, sol::protected_function>> key_handlers;
+    // id -> handler, which keys and states each one is for is in key_handler_table
+    std::unordered_map<unsigned int, sol::protected_function> key_handlers;
+    KeyHandlerTable key_handler_table;
+    // Which keys do what, the is*Key functions look in it
+    Keymap keymap;
+    // Kept around so that handling a key doesn't allocate
+    std::vector<unsigned int> matched_key_handlers;
+    // Handlers removed while keys are being handled, only destroyed once that's done since one may be running
+    bool handling_keys = false;
+    std::vector<unsigned int> removed_key_handlers;
 
     Window bar;
     UIBarAsking bar_asking = UIBarAsking::NONE;
     std::string bar_message = "";
+    // What has been typed while bar_asking is UIBarAsking::Command
+    std::string bar_input = "";
+    // Digits typed before a motion, such as the 5000 in 5000j. 0 if there's none.
+    size_t motion_count = 0;
+    static constexpr size_t MAX_MOTION_COUNT = 1000000000000;
+
+    FrameTimes frame_times;
+    // The stages for each sub view's render and resize, by its id. Added once it's first drawn.
+    std::vector<std::pair<FrameTimes::StageID, FrameTimes::StageID>> sub_view_stages;
+    // If the frame times are drawn over the view
+    bool frame_times_visible = false;
+    // The name of the plugin being loaded, given to the sub views it creates
+    std::string loading_plugin = "";
 
     ViewWindow view;
 
-    HerixLib::Herix hex;
+    EditLayer hex;
+    // What was opened, for things which read the file on their own (such as background workers)
+    std::filesystem::path filename;
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range;
+
+    // Only created once something needs it, since it scans the entire file
+    std::unique_ptr<FileSummary> file_summary;
+    std::optional<MinimapView> minimap;
+    std::optional<DataInspectorView> inspector;
+    // Where the inspector was last rendered (x, y, width, height on the view), while nothing has been drawn over it
+    // since. Its output is kept rather than redrawn if it's in the same place and its fields didn't change.
+    std::optional<std::array<int, 4>> inspector_area;
+
+    // Only in diff mode: the file being compared against, and the comparison itself
+    std::unique_ptr<HerixLib::Herix> diff_hex;
+    std::unique_ptr<DiffEngine> diff;
+
+    std::unique_ptr<ReplaceAllTask> replace_all;
+    std::unique_ptr<FileHashTask> file_hash;
+    // Digests of the whole file by algorithm name, as of file_hashes_version
+    std::unordered_map<std::string, std::string> file_hashes;
+    std::optional<uint64_t> file_hashes_version;
+    std::unique_ptr<FileStatsTask> file_stats_task;
+    // Stats of the whole file, as of file_stats_version
+    std::optional<RangeStats> file_stats;
+    uint64_t file_stats_version = 0;
 
     std::vector<InformationNote> information_notes;
+
+    std::vector<LazyPlugin> lazy_plugins;
+    // Key -> indices into lazy_plugins, removed once the key has been pressed
+    std::unordered_map<int, std::vector<size_t>> lazy_key_plugins;
+    // The start of the file as read by the FilePrimer, for the magic of plugins. Only kept while they're loaded.
+    std::vector<HerixLib::Byte> file_start;
     std::string current_information_text = "";
     size_t information_selected = 0;
     // Used for scrolling in InfoAsking and Info
     size_t information_row_pos = 0;
 
+    // Results of the last strings scan, only kept while UIState::Strings is open
+    std::vector<StringHit> string_hits;
+    // The scan behind the strings panel, until it has finished. Closing the panel cancels it.
+    std::unique_ptr<StringScanTask> string_scan;
+    size_t string_selected = 0;
+    size_t string_row_pos = 0;
+
     sol::protected_function on_write;
     // Callbacks which are called when we save.
     // These are assured to be called _before_ we save, so that any special edits can happen
@@ -89,15 +226,19 @@ class UIDisplay {
     std::vector<sol::protected_function> on_init;
 
 
-    std::optional<size_t> cached_file_end = std::nullopt;
     bool should_edit_move_forward = true;
+    // If typing a byte while editing inserts it rather than overwriting the one at the cursor
+    bool insert_mode = false;
 
     // Note: these two functions should be ignored after initialization!
     HerixLib::ChunkSize getMaxChunkMemory ();
     HerixLib::ChunkSize getMaxChunkSize ();
+    // Budget for the bytes held by unsaved edits, past which they're moved to a temporary file
+    size_t getMaxEditMemory ();
 
 
-    UIDisplay (std::filesystem::path t_filename, std::filesystem::path t_config_file, std::filesystem::path t_plugins_directory, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range, bool t_debug);
+    UIDisplay (std::filesystem::path t_filename, std::filesystem::path t_config_file, std::filesystem::path t_plugins_directory, bool t_allow_writing, std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> t_file_range, bool t_debug,
+        std::optional<std::filesystem::path> t_diff_filename = std::nullopt, FilePrimer* t_primer = nullptr);
 
     ~UIDisplay ();
 
@@ -138,9 +279,13 @@ class UIDisplay {
 
     void setShouldEditMoveForward (bool val);
 
+    // Called for every key, in any state
     unsigned int registerKeyHandler (sol::protected_function handler);
+    // Only called for the key (a key code or a single character), and only in the states if they are given
+    unsigned int registerKeyHandlerFor (sol::object key, sol::protected_function handler, sol::optional<UIState> for_ui_state, sol::optional<HexViewState> for_hex_view_state);
 
-    void removeKeyHandler (int id);
+    // Returns false if there was no such handler
+    bool removeKeyHandler (unsigned int id);
 
     bool setBarMessage (std::string value);
     void clearBarMessage ();
@@ -150,6 +295,23 @@ class UIDisplay {
 
     size_t createSubView (ViewLocation loc);
     SubView& getSubView (size_t id);
+    size_t createEntropyView ();
+    size_t createMinimapView ();
+    size_t createDataInspectorView ();
+    // Starts comparing against the other file, and shows it next to the hex view.
+    size_t createDiffView (std::filesystem::path other);
+
+    bool isDiffMode () const;
+    // If the byte (in the opened file) is part of a difference found so far
+    bool isDiffPosition (HerixLib::FilePosition pos) const;
+    size_t getDiffHunkCount () const;
+
+    FileSummary& getFileSummary ();
+    // Should be called whenever bytes are changed, so anything computed from them can be redone.
+    void markModified (HerixLib::FilePosition pos, size_t length);
+    // Call after bytes were inserted/removed at pos, since everything after it moved
+    void markLayoutChanged (HerixLib::FilePosition pos);
+    void markChanged (const EditChange& change);
 
     HerixLib::FilePosition getSelectedRow ();
     int getViewHeight () const;
@@ -159,6 +321,20 @@ class UIDisplay {
     bool lua_hasByte (HerixLib::FilePosition pos);
     HerixLib::Byte lua_readByte (HerixLib::FilePosition pos);
     std::vector<HerixLib::Byte> lua_readBytes (HerixLib::FilePosition pos, size_t length);
+    std::string lua_hashRange (std::string algorithm, HerixLib::FilePosition pos, size_t length);
+    sol::table lua_rangeStats (HerixLib::FilePosition pos, size_t length);
+    // Table of algorithm name -> digest of the whole file, or nil if they're still being computed. The open note is
+    // refreshed once they are.
+    sol::object lua_fileHashes (sol::table algorithms);
+    // Same as rangeStats over the whole file, or nil while it's still being counted. The open note is refreshed
+    // once it has been.
+    sol::object lua_fileStats ();
+    sol::table makeRangeStatsTable (const RangeStats& stats);
+    // {resident, spilled}: bytes held by edits in memory, and moved out to the temporary file
+    sol::table lua_editMemoryStats ();
+    EventLoop::TimerID lua_setTimeout (sol::protected_function cb, int64_t ms);
+    EventLoop::TimerID lua_setInterval (sol::protected_function cb, int64_t ms);
+    bool lua_clearTimer (EventLoop::TimerID id);
     HerixLib::FilePosition getRowOffset () const;
     HerixLib::FilePosition getRowPosition () const;
     void setRowPosition (HerixLib::FilePosition pos);
@@ -177,6 +353,17 @@ class UIDisplay {
 
     void loadPlugins ();
     void loadPlugin (const std::string& filename);
+    // Runs the plugin in an environment with the libraries it's granted, if the profile is minimal
+    void runPlugin (const std::string& filename, const std::vector<std::string>& libraries);
+    // A table in the plugins list: {path = ..., and optionally a trigger}. With magic = "..." (at magic_offset) it's
+    // only loaded if the file starts with it, with keys = {...} once one of the keys is pressed, and with
+    // info = "name" once that entry of the information menu is opened. Without any it's loaded right away.
+    // libraries = {...} grants it those libraries under the minimal profile.
+    void loadPluginManifest (sol::table manifest);
+    void activatePlugin (size_t index);
+    // Loads (through script_cache) and runs the lua file, in the environment if one is given, throwing sol::error
+    // if either fails
+    void runScriptFile (const std::filesystem::path& path, const std::optional<sol::environment>& environment = std::nullopt);
 
     void setupBar ();
 
@@ -188,6 +375,8 @@ class UIDisplay {
     void drawBar ();
 
     void drawView ();
+    // Clears the view apart from the area, which is left as it was drawn
+    void eraseViewExcept (const std::array<int, 4>& area);
 
     void resize ();
 
@@ -195,13 +384,25 @@ class UIDisplay {
 
     void undo (bool dialog=false);
     void redo (bool dialog=false);
+    // Each is its own undo step. Return false if nothing was changed.
+    bool insertBytes (HerixLib::FilePosition pos, std::vector<HerixLib::Byte> bytes);
+    bool eraseBytes (HerixLib::FilePosition pos, size_t length);
+    // Kept as a single edit each, which holds the pattern/where in the other file rather than the bytes
+    bool fillRange (HerixLib::FilePosition pos, size_t length, std::vector<HerixLib::Byte> pattern);
+    bool pasteFromFile (std::string path, uint64_t source_offset, HerixLib::FilePosition pos, size_t length);
+
+    // Replaces every occurrence of find with replacement (which has to be the same length), searching in the
+    // background. Returns false if it couldn't be started.
+    bool replaceAll (std::vector<HerixLib::Byte> find, std::vector<HerixLib::Byte> replacement);
+    bool isReplacing () const;
+    void cancelReplace ();
 
     void listenForUndo (sol::protected_function cb);
     void listenForRedo (sol::protected_function cb);
 
-    void invalidateCaches ();
-
 // == KEY HANDLING
+    // Rebinds keys from the `keymap` table in the configuration
+    void loadKeymap ();
     // TODO: make these all const
     bool isExitKey (int k) const;
     bool isYesKey (int k) const;
@@ -223,13 +424,41 @@ class UIDisplay {
     bool isHomeKey (int k) const;
     bool isUndoKey (int k) const;
     bool isRedoKey (int k) const;
+    bool isStringsKey (int k) const;
+    bool isMinimapKey (int k) const;
+    bool isZoomInKey (int k) const;
+    bool isZoomOutKey (int k) const;
+    bool isNextHunkKey (int k) const;
+    bool isInspectorKey (int k) const;
+    bool isInsertModeKey (int k) const;
+    bool isDeleteKey (int k) const;
+    bool isBackspaceKey (int k) const;
+    bool isPreviousHunkKey (int k) const;
+    bool isCommandKey (int k) const;
+    bool isFrameTimesKey (int k) const;
 
 // == EVENT HANDLING
 
     KeyHandleFlags handleKeyHandlers ();
+    // Ends handling keys, destroying the handlers that were removed during it
+    void finishHandlingKeys ();
 
     void handleInit ();
     void handleEvent ();
+    // Called by the event loop on SIGWINCH, handled as if KEY_RESIZE was pressed
+    void handleResize ();
+    // Called when the event loop woke up without a key being pressed: a timeout, a timer, or a worker finishing
+    void handleIdle ();
+    // Puts the percentiles of each stage of drawing into the exit logs, if the config asks for it with frame_times
+    void reportFrameTimes ();
+    bool hasPendingWork () const;
+    // How long the event loop should wait before handleIdle is called anyway, in milliseconds (-1 to wait until
+    // something happens)
+    int getIdleTimeout () const;
+    // Wakes the event loop from a worker thread, so what it finished gets taken in without waiting for a key
+    void wakeFromWorker ();
+    // Returns true if anything that is drawn changed
+    bool updateBackgroundWork ();
 
     void handleDownKeyMovement ();
 
@@ -248,6 +477,21 @@ class UIDisplay {
     void handleRightKeyEditingMovement ();
 
     void handleJumpEndOfFile ();
+    // Puts pos on the top row of the screen, with the cursor at the start of it
+    void handleJumpToPosition (HerixLib::FilePosition pos);
+    void handleJumpToHunk (bool forward);
+    // Takes a digit into the count, or does the motion the count was for. Returns false if the key isn't either.
+    bool handleCountedMotion ();
+    // Moves count times at once, so it costs the same (and is drawn once) however large the count is
+    void handleCountedMovement (size_t count);
+    // Starts reading in the page at the top of the view ahead of drawing it, if it's far from old_row_pos
+    void prefetchView (HerixLib::FilePosition old_row_pos);
+
+    // Typing into the bar after `:`, ran on enter
+    void handleCommandInput ();
+    void runCommand (const std::string& command);
+    // "0x1f00" (hex), "7936" (decimal) or "50%" (of the file). nullopt if it's none of them.
+    std::optional<HerixLib::FilePosition> parseGotoTarget (const std::string& target);
 
     void handleJumpEndOfLine ();
     void handleJumpStartOfLine ();
@@ -262,17 +506,32 @@ class UIDisplay {
 
     void handleFunctionalHex ();
 
+    void handleFunctionalMinimap ();
+    void handleMouse ();
+
     void handleFunctionalInfoAsking ();
 
     void handleFunctionalInfo ();
+    // Gets the text of the selected note again, if it's open. Returns true if it was.
+    bool refreshInformation ();
+
+    void openStrings ();
+    // Takes in the hits once the scan has finished
+    void finishStrings ();
+    void closeStrings ();
+    void handleFunctionalStrings ();
 
     void handleFunctional ();
 
     void handleSpecial ();
 
     void handleDrawing ();
+    // The frame times overlay, in the top right of the view
+    void drawFrameTimes ();
+    const std::pair<FrameTimes::StageID, FrameTimes::StageID>& getSubViewStages (size_t id);
     void drawInfoAsking ();
     void drawInfo ();
+    void drawStrings ();
 };
 
 #endif
@@ -0,0 +1,211 @@
+#include "./undojournal.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./hashing.hpp"
+
+namespace {
+    // Layout: JOURNAL_MAGIC, [u64 length][fingerprint], then entries of [u64 length][payload][u32 ENTRY_END].
+    // The end marker is what tells an entry that was fully written from one cut off partway.
+    constexpr char JOURNAL_MAGIC[8] = {'H', 'E', 'R', 'I', 'X', 'U', 'N', 'D'};
+    constexpr uint32_t ENTRY_END = 0x21444E45;
+
+    bool readAt (int fd, uint64_t offset, void* out, size_t length) {
+        auto* bytes = reinterpret_cast<HerixLib::Byte*>(out);
+        while (length > 0) {
+            ssize_t amount = pread(fd, bytes, length, static_cast<off_t>(offset));
+            if (amount < 0 && errno == EINTR) {
+                continue;
+            } else if (amount <= 0) {
+                return false;
+            }
+            bytes += amount;
+            length -= static_cast<size_t>(amount);
+            offset += static_cast<uint64_t>(amount);
+        }
+        return true;
+    }
+}
+
+UndoJournal::UndoJournal () {}
+UndoJournal::UndoJournal (UndoJournal&& other) noexcept :
+    fd(std::exchange(other.fd, -1)), size(std::exchange(other.size, 0)), opened_entries(std::move(other.opened_entries)),
+    map(std::exchange(other.map, nullptr)), map_size(std::exchange(other.map_size, 0)) {}
+UndoJournal& UndoJournal::operator= (UndoJournal&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = std::exchange(other.fd, -1);
+        size = std::exchange(other.size, 0);
+        opened_entries = std::move(other.opened_entries);
+        map = std::exchange(other.map, nullptr);
+        map_size = std::exchange(other.map_size, 0);
+    }
+    return *this;
+}
+UndoJournal::~UndoJournal () {
+    close();
+}
+
+void UndoJournal::open (const std::filesystem::path& path, const std::string& fingerprint) {
+    close();
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Could not open undo history: ") + std::strerror(errno));
+    }
+    // Another instance editing the same file would truncate it under this one's mapping, and append over its entries
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        int lock_error = errno;
+        close();
+        if (lock_error == EWOULDBLOCK) {
+            throw std::runtime_error("another instance has the file open, the history is only kept in memory.");
+        }
+        throw std::runtime_error(std::string("Could not lock undo history: ") + std::strerror(lock_error));
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close();
+        throw std::runtime_error(std::string("Could not open undo history: ") + std::strerror(errno));
+    }
+    const uint64_t file_size = static_cast<uint64_t>(file_stat.st_size);
+
+    // Anything that doesn't match is treated as a history for some other version of the file
+    char magic[sizeof(JOURNAL_MAGIC)];
+    uint64_t fingerprint_length = 0;
+    std::string stored(fingerprint.size(), '\0');
+    bool matches = readAt(fd, 0, magic, sizeof(magic)) && std::memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) == 0 &&
+        readAt(fd, sizeof(magic), &fingerprint_length, sizeof(fingerprint_length)) && fingerprint_length == fingerprint.size() &&
+        readAt(fd, sizeof(magic) + sizeof(fingerprint_length), stored.data(), stored.size()) && stored == fingerprint;
+    if (!matches) {
+        reset(fingerprint);
+        return;
+    }
+
+    uint64_t offset = sizeof(magic) + sizeof(fingerprint_length) + fingerprint.size();
+    while (offset < file_size) {
+        uint64_t length = 0;
+        uint32_t end_mark = 0;
+        if (!readAt(fd, offset, &length, sizeof(length)) || length > file_size ||
+            !readAt(fd, offset + sizeof(length) + length, &end_mark, sizeof(end_mark)) || end_mark != ENTRY_END) {
+            break;
+        }
+        opened_entries.emplace_back(offset + sizeof(length), static_cast<size_t>(length));
+        offset += sizeof(length) + length + sizeof(end_mark);
+    }
+    size = offset;
+    if (size != file_size && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close();
+        throw std::runtime_error(std::string("Could not repair undo history: ") + std::strerror(errno));
+    }
+}
+
+bool UndoJournal::isOpen () const {
+    return fd >= 0;
+}
+
+void UndoJournal::reset (const std::string& fingerprint) {
+    unmap();
+    opened_entries.clear();
+    if (ftruncate(fd, 0) != 0) {
+        throw std::runtime_error(std::string("Could not reset undo history: ") + std::strerror(errno));
+    }
+    size = 0;
+    writeHeader(fingerprint);
+}
+
+uint64_t UndoJournal::append (const std::vector<HerixLib::Byte>& payload) {
+    const uint64_t length = payload.size();
+    const uint64_t offset = size;
+    writeAt(offset, &length, sizeof(length));
+    writeAt(offset + sizeof(length), payload.data(), payload.size());
+    writeAt(offset + sizeof(length) + length, &ENTRY_END, sizeof(ENTRY_END));
+    size = offset + sizeof(length) + length + sizeof(ENTRY_END);
+    return offset + sizeof(length);
+}
+
+const HerixLib::Byte* UndoJournal::getData (uint64_t offset, size_t length) const {
+    if (offset + length > map_size) {
+        // The file only grows, so mapping all of it again covers everything appended since
+        unmap();
+        void* result = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (result == MAP_FAILED) {
+            throw std::runtime_error(std::string("Could not map undo history: ") + std::strerror(errno));
+        }
+        map = reinterpret_cast<const HerixLib::Byte*>(result);
+        map_size = size;
+    }
+    return map + offset;
+}
+
+const std::vector<std::pair<uint64_t, size_t>>& UndoJournal::getOpenedEntries () const {
+    return opened_entries;
+}
+
+std::filesystem::path UndoJournal::getPath (const std::filesystem::path& state_directory, const std::filesystem::path& filename,
+    std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::weakly_canonical(filename, error);
+    if (error) {
+        absolute = std::filesystem::absolute(filename);
+    }
+
+    std::string key = absolute.string() + ":" + std::to_string(file_range.first) + "-" +
+        (file_range.second.has_value() ? std::to_string(file_range.second.value()) : "");
+    Hasher hasher(HashAlgorithm::XXH64);
+    hasher.update(reinterpret_cast<const HerixLib::Byte*>(key.data()), key.size());
+    return state_directory / "undo" / (hasher.finish() + ".undo");
+}
+
+void UndoJournal::writeHeader (const std::string& fingerprint) {
+    const uint64_t fingerprint_length = fingerprint.size();
+    writeAt(0, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    writeAt(sizeof(JOURNAL_MAGIC), &fingerprint_length, sizeof(fingerprint_length));
+    writeAt(sizeof(JOURNAL_MAGIC) + sizeof(fingerprint_length), fingerprint.data(), fingerprint.size());
+    size = sizeof(JOURNAL_MAGIC) + sizeof(fingerprint_length) + fingerprint.size();
+}
+
+void UndoJournal::writeAt (uint64_t offset, const void* data, size_t length) {
+    const auto* bytes = reinterpret_cast<const HerixLib::Byte*>(data);
+    while (length > 0) {
+        ssize_t written = pwrite(fd, bytes, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed writing undo history: ") + std::strerror(errno));
+        }
+        bytes += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+void UndoJournal::unmap () const {
+    if (map != nullptr) {
+        munmap(const_cast<HerixLib::Byte*>(map), map_size);
+        map = nullptr;
+        map_size = 0;
+    }
+}
+
+void UndoJournal::close () {
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    size = 0;
+    opened_entries.clear();
+}
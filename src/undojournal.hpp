@@ -0,0 +1,56 @@
+#ifndef FILE_SEEN_UNDOJOURNAL
+#define FILE_SEEN_UNDOJOURNAL
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include "./Herix/src/herix.hpp"
+
+// An append-only file of entries, memory-mapped for reading, which keeps the undo history of a file on disk.
+// So the history survives restarting the editor, and what the entries hold doesn't have to stay in memory.
+// It starts with the fingerprint of the file it was written for, and is emptied if opened for a different one.
+// Throws std::runtime_error if the file can't be created/written.
+class UndoJournal {
+    public:
+    UndoJournal ();
+    UndoJournal (const UndoJournal&) = delete;
+    UndoJournal& operator= (const UndoJournal&) = delete;
+    UndoJournal (UndoJournal&& other) noexcept;
+    UndoJournal& operator= (UndoJournal&& other) noexcept;
+    ~UndoJournal ();
+
+    // Opens the journal at path, creating it (and its directory) if needed. Entries cut off by a crash are dropped.
+    // It stays locked while open, and throws if another instance has it locked.
+    void open (const std::filesystem::path& path, const std::string& fingerprint);
+    bool isOpen () const;
+    // Drops every entry, to start the history over for a file which now has the fingerprint.
+    void reset (const std::string& fingerprint);
+
+    // Returns the offset the payload was put at
+    uint64_t append (const std::vector<HerixLib::Byte>& payload);
+    // [offset, offset + size) of the file, through the mapping. Valid until the next append/reset.
+    const HerixLib::Byte* getData (uint64_t offset, size_t size) const;
+    // (offset, size) of the payload of every entry that was in the file when it was opened, oldest first.
+    const std::vector<std::pair<uint64_t, size_t>>& getOpenedEntries () const;
+
+    // Where the journal for the file (opened with the range) goes, inside of the state directory.
+    static std::filesystem::path getPath (const std::filesystem::path& state_directory, const std::filesystem::path& filename,
+        std::pair<HerixLib::AbsoluteFilePosition, std::optional<HerixLib::AbsoluteFilePosition>> file_range);
+
+    private:
+    int fd = -1;
+    uint64_t size = 0;
+    std::vector<std::pair<uint64_t, size_t>> opened_entries;
+
+    mutable const HerixLib::Byte* map = nullptr;
+    mutable size_t map_size = 0;
+
+    void writeHeader (const std::string& fingerprint);
+    void writeAt (uint64_t offset, const void* data, size_t length);
+    void unmap () const;
+    void close ();
+};
+
+#endif
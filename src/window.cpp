@@ -36,7 +36,8 @@ void Window::print (std::string str) {
 }
 
 void Window::print (const char* str) {
-    wprintw(win, str);
+    // Not wprintw, since the text may contain '%' (e.g. file contents)
+    waddstr(win, str);
 }
 
 
@@ -59,7 +60,7 @@ int ViewWindow::getHexHeight () const {
     return height;
 }
 int ViewWindow::getHexByteWidth () const {
-    return (width - getLeftWidth()) / 4;
+    return (width - getLeftWidth() - getFixedRightWidth()) / (4 + extra_byte_columns);
 }
 
 int ViewWindow::getRightWidth () const {
@@ -80,6 +81,40 @@ int ViewWindow::getLeftWidth () const {
     }
     return ret;
 }
+int ViewWindow::getFixedRightWidth () const {
+    int ret = 0;
+    for (const SubView& sv : sub_views) {
+        if (sv.getLoc() == ViewLocation::Right && sv.getVisible() && sv.getFixedWidth() && sv.getWidth() != -1) {
+            ret += sv.getWidth();
+        }
+    }
+    return ret;
+}
+
+int ViewWindow::getRightOffset (const SubView& target) const {
+    int ret = 0;
+    for (const SubView& sv : sub_views) {
+        if (&sv == &target) {
+            break;
+        }
+        if (sv.getLoc() == ViewLocation::Right && sv.getVisible() && sv.getWidth() != -1) {
+            ret += sv.getWidth();
+        }
+    }
+    return ret;
+}
+int ViewWindow::getLeftOffset (const SubView& target) const {
+    int ret = 0;
+    for (const SubView& sv : sub_views) {
+        if (&sv == &target) {
+            break;
+        }
+        if (sv.getLoc() == ViewLocation::Left && sv.getVisible() && sv.getWidth() != -1) {
+            ret += sv.getWidth();
+        }
+    }
+    return ret;
+}
 
 void ViewWindow::enableColor (MColors color) {
     wattron(win, COLOR_PAIR(static_cast<short>(color)));
@@ -32,6 +32,9 @@ struct Window {
 
 struct ViewWindow : public Window {
     std::vector<SubView> sub_views;
+    // Columns that views showing something per byte of a row take, besides the hex view's 3 and the ascii view's 1.
+    // Such as the second file's hex in diff mode.
+    int extra_byte_columns = 0;
 
     ~ViewWindow ();
 
@@ -44,6 +47,11 @@ struct ViewWindow : public Window {
 
     int getRightWidth () const;
     int getLeftWidth () const;
+    int getFixedRightWidth () const;
+
+    // Where the subview starts, relative to the other subviews on the same side before it.
+    int getRightOffset (const SubView& target) const;
+    int getLeftOffset (const SubView& target) const;
 
     void enableColor (MColors color);
     void disableColor (MColors color);